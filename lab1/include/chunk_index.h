@@ -0,0 +1,15 @@
+// Lab 1 - write tokenized chunks as a binary token index (token_index.h)
+#ifndef LAB1_CHUNK_INDEX_H
+#define LAB1_CHUNK_INDEX_H
+
+#include <stddef.h>
+
+#include "parallel.h"
+
+/* Write the index header, then one (offset, length) entry per token of
+   `chunks` in order, with offsets into the `input_size`-byte input.
+   Returns 0, or -1 with errno set. */
+int write_chunk_index(int fd, size_t input_size, const token_chunk_t *chunks,
+                      size_t nchunks);
+
+#endif
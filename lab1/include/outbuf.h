@@ -0,0 +1,35 @@
+// Lab 1 - buffered bulk output over write(2)/writev(2)
+#ifndef LAB1_OUTBUF_H
+#define LAB1_OUTBUF_H
+
+#include <stddef.h>
+
+typedef struct {
+  int fd;
+  char *data;
+  size_t used;
+  size_t capacity;
+} outbuf_t;
+
+/* Returns 0, or -1 if the buffer could not be allocated. */
+int outbuf_init(outbuf_t *ob, int fd, size_t capacity);
+
+/* Frees the buffer without flushing it. */
+void outbuf_destroy(outbuf_t *ob);
+
+/* Queue `len` bytes. Writes larger than the buffer go straight out with one
+   writev alongside whatever is already queued. Returns 0 or -1 (errno). */
+int outbuf_write(outbuf_t *ob, const void *data, size_t len);
+
+static inline int outbuf_putc(outbuf_t *ob, char c) {
+  if (ob->used == ob->capacity) {
+    return outbuf_write(ob, &c, 1);
+  }
+  ob->data[ob->used++] = c;
+  return 0;
+}
+
+/* Write everything queued. Returns 0 or -1 (errno). */
+int outbuf_flush(outbuf_t *ob);
+
+#endif
@@ -0,0 +1,30 @@
+// Lab 1 - multi-threaded tokenization of an in-memory (mmap'd) buffer
+#ifndef LAB1_PARALLEL_H
+#define LAB1_PARALLEL_H
+
+#include <stddef.h>
+
+#include "tokenizer.h"
+
+/* One slice of the input. Span offsets in `tokens` are relative to `begin`;
+   chunks are in input order and never split a token. */
+typedef struct {
+  size_t begin;
+  size_t end;
+  token_vec_t tokens;
+} token_chunk_t;
+
+/* Split buf[0, len) into `nchunks` slices whose boundaries sit on delimiter
+   bytes, so no token crosses a boundary. Slices may be empty. */
+void split_chunks(const tokenizer_t *tok, const char *buf, size_t len,
+                  token_chunk_t *chunks, size_t nchunks);
+
+/* Split and tokenize buf[0, len) on `nchunks` threads. `chunks` must hold
+   `nchunks` entries and is initialized here; release it with
+   free_chunks(). Returns 0, or -1 with errno set. */
+int tokenize_parallel(const tokenizer_t *tok, const char *buf, size_t len,
+                      token_chunk_t *chunks, size_t nchunks);
+
+void free_chunks(token_chunk_t *chunks, size_t nchunks);
+
+#endif
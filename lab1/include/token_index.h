@@ -0,0 +1,66 @@
+// Lab 1 - binary token index (writer helpers + mmap reader)
+//
+// Layout, native byte order (little-endian on the machines we run on):
+//
+//   token_index_header_t                    32 bytes
+//   token_index_entry_t[token_count]        16 bytes each, packed
+//
+// Entry N is the (offset, length) of token N in the original input, so a
+// consumer that maps the index and the input reaches any token in O(1).
+#ifndef LAB1_TOKEN_INDEX_H
+#define LAB1_TOKEN_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOKEN_INDEX_MAGIC "L1TOKIDX"
+#define TOKEN_INDEX_VERSION 1
+
+typedef struct {
+  char magic[8];        /* TOKEN_INDEX_MAGIC, not NUL-terminated */
+  uint32_t version;     /* TOKEN_INDEX_VERSION */
+  uint32_t entry_size;  /* sizeof(token_index_entry_t) */
+  uint64_t token_count;
+  uint64_t input_size;  /* size of the input the offsets point into */
+} token_index_header_t;
+
+typedef struct {
+  uint64_t offset;
+  uint64_t length;
+} token_index_entry_t;
+
+_Static_assert(sizeof(token_index_header_t) == 32, "header must be packed");
+_Static_assert(sizeof(token_index_entry_t) == 16, "entry must be packed");
+
+void token_index_header_init(token_index_header_t *hdr, uint64_t token_count,
+                             uint64_t input_size);
+
+/* ---------- reader ---------- */
+
+typedef struct {
+  const token_index_header_t *header;
+  const token_index_entry_t *entries;
+  size_t map_size;
+} token_index_t;
+
+/* Map and validate an index file. Returns 0, or -1 with errno set (EINVAL
+   for a file that is not a well-formed index). */
+int token_index_open(token_index_t *idx, const char *path);
+
+void token_index_close(token_index_t *idx);
+
+static inline uint64_t token_index_count(const token_index_t *idx) {
+  return idx->header->token_count;
+}
+
+static inline uint64_t token_index_input_size(const token_index_t *idx) {
+  return idx->header->input_size;
+}
+
+/* Token n (n < token_index_count()). */
+static inline token_index_entry_t token_index_get(const token_index_t *idx,
+                                                  uint64_t n) {
+  return idx->entries[n];
+}
+
+#endif
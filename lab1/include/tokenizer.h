@@ -0,0 +1,71 @@
+// Lab 1 - zero-copy delimiter tokenizer
+//
+// Finds maximal runs of non-delimiter bytes (the same tokens strtok_r would
+// return) without writing into the input. The delimiter scan runs 64 bytes
+// per step using SSE2 or AVX2 compares; the engine is picked at init time.
+#ifndef LAB1_TOKENIZER_H
+#define LAB1_TOKENIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Up to this many distinct delimiters are matched with vector compares;
+// larger sets fall back to the scalar lookup table.
+#define TOK_MAX_SIMD_DELIMS 16
+
+typedef enum {
+  TOK_ISA_AUTO = 0, // widest engine the running CPU supports
+  TOK_ISA_SCALAR,
+  TOK_ISA_SSE2,
+  TOK_ISA_AVX2,
+} tok_isa_t;
+
+/* A token is a view into the caller's buffer. */
+typedef struct {
+  size_t offset;
+  size_t length;
+} token_span_t;
+
+/* Growable array of spans; reuse it across calls to avoid reallocating. */
+typedef struct {
+  token_span_t *spans;
+  size_t count;
+  size_t capacity;
+} token_vec_t;
+
+typedef struct {
+  uint8_t is_delim[256];
+  uint8_t delims[TOK_MAX_SIMD_DELIMS];
+  size_t num_delims;
+  tok_isa_t isa;
+} tokenizer_t;
+
+/* Build a tokenizer for the bytes in `delims` (a C string, may be empty).
+   Returns 0, or -1 if the requested engine is not available on this CPU. */
+int tokenizer_init(tokenizer_t *tok, const char *delims, tok_isa_t isa);
+
+/* Name of an engine ("scalar", "sse2", "avx2"), for logs and benchmarks. */
+const char *tok_isa_name(tok_isa_t isa);
+
+/* Whether `isa` can run on this CPU (TOK_ISA_AUTO always can). */
+int tok_isa_supported(tok_isa_t isa);
+
+void token_vec_init(token_vec_t *vec);
+void token_vec_free(token_vec_t *vec);
+
+/* Append the spans of every token in buf[0, len) to `out` (offsets are
+   relative to `buf`). Returns 0, or -1 with errno = ENOMEM. */
+int tokenize(const tokenizer_t *tok, const char *buf, size_t len,
+             token_vec_t *out);
+
+/* Shell-style variant: '...' and "..." keep delimiters inside a token and a
+   backslash escapes the next byte (inside "..." only before " and \).
+   Quotes and escaping backslashes are removed; an empty quoted string is an
+   empty token. The input minus those bytes is written to `text`, which must
+   hold `len` bytes, and the spans appended to `out` index into `text`.
+   Quote and backslash bytes are never treated as delimiters.
+   Returns 0, or -1 with errno = EINVAL (unterminated quote) or ENOMEM. */
+int tokenize_quoted(const tokenizer_t *tok, const char *buf, size_t len,
+                    char *text, token_vec_t *out);
+
+#endif
@@ -0,0 +1,44 @@
+// Lab 1 - write tokenized chunks as a binary token index
+#include "chunk_index.h"
+
+#include <stdint.h>
+
+#include "outbuf.h"
+#include "token_index.h"
+
+#define WRITE_SIZE (1 << 20)
+
+int write_chunk_index(int fd, size_t input_size, const token_chunk_t *chunks,
+                      size_t nchunks) {
+  uint64_t count = 0;
+  for (size_t k = 0; k < nchunks; k++) {
+    count += chunks[k].tokens.count;
+  }
+
+  outbuf_t out;
+  if (outbuf_init(&out, fd, WRITE_SIZE) < 0) {
+    return -1;
+  }
+  token_index_header_t header;
+  token_index_header_init(&header, count, input_size);
+  if (outbuf_write(&out, &header, sizeof(header)) < 0) {
+    outbuf_destroy(&out);
+    return -1;
+  }
+  for (size_t k = 0; k < nchunks; k++) {
+    for (size_t i = 0; i < chunks[k].tokens.count; i++) {
+      const token_span_t *token = &chunks[k].tokens.spans[i];
+      token_index_entry_t entry = {
+          .offset = chunks[k].begin + token->offset,
+          .length = token->length,
+      };
+      if (outbuf_write(&out, &entry, sizeof(entry)) < 0) {
+        outbuf_destroy(&out);
+        return -1;
+      }
+    }
+  }
+  int rc = outbuf_flush(&out);
+  outbuf_destroy(&out);
+  return rc;
+}
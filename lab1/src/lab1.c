@@ -0,0 +1,407 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chunk_index.h"
+#include "outbuf.h"
+#include "parallel.h"
+#include "tokenizer.h"
+
+// Stream mode reads stdin and writes stdout in blocks of these sizes, so
+// memory stays fixed no matter how large the input is.
+#define STREAM_READ_SIZE (1 << 20)
+#define STREAM_WRITE_SIZE (1 << 20)
+
+#define MAX_THREADS 256
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [-q | -s] [-d delimiters]\n", prog);
+  fprintf(stderr, "       %s [-j threads] [-V | -b] [-d delimiters] file\n",
+          prog);
+  fprintf(stderr, "       %s -q [-d delimiters] file\n", prog);
+  fprintf(stderr, "  -q  shell-style tokens: quotes group, backslash "
+                  "escapes (default delimiters: space, tab, newline)\n");
+  fprintf(stderr, "  -s  tokenize all of stdin (no prompt), one token per "
+                  "line\n");
+  fprintf(stderr, "  -j  threads for file input (default: online CPUs)\n");
+  fprintf(stderr, "  -V  check the threaded result against the "
+                  "single-threaded scalar path\n");
+  fprintf(stderr, "  -b  write a binary token index (see token_index.h) "
+                  "instead of text\n");
+}
+
+// Quoted mode unescapes into a separate buffer the size of the input; plain
+// mode's spans point straight into `buf`. *text is what the spans index.
+static int tokenize_input(const tokenizer_t *tokenizer, bool quoted,
+                          const char *buf, size_t len, char **text,
+                          token_vec_t *tokens) {
+  if (!quoted) {
+    *text = (char *)buf;
+    return tokenize(tokenizer, buf, len, tokens);
+  }
+  *text = malloc(len > 0 ? len : 1);
+  if (*text == NULL) {
+    return -1;
+  }
+  if (tokenize_quoted(tokenizer, buf, len, *text, tokens) < 0) {
+    int err = errno;
+    free(*text);
+    *text = NULL;
+    errno = err;
+    return -1;
+  }
+  return 0;
+}
+
+static void report_tokenize_error(void) {
+  if (errno == EINVAL) {
+    fprintf(stderr, "tokenize failed: unterminated quote\n");
+  } else {
+    perror("tokenize failed");
+  }
+}
+
+/* ---------- interactive: one line from getline ---------- */
+
+static int run_line_mode(const tokenizer_t *tokenizer, bool quoted) {
+  char *input_buffer = NULL;
+  size_t buffer_capacity = 0;
+  ssize_t characters_read;
+
+  printf("Please enter some text: ");
+
+  characters_read = getline(&input_buffer, &buffer_capacity, stdin);
+
+  if (characters_read == -1) {
+    perror("getline failed");
+    free(input_buffer);
+    return EXIT_FAILURE;
+  }
+
+  // strtok_r stopped at the first NUL, so the tokenizer does too.
+  size_t input_length = strlen(input_buffer);
+  token_vec_t tokens;
+  char *text;
+  token_vec_init(&tokens);
+
+  if (tokenize_input(tokenizer, quoted, input_buffer, input_length, &text,
+                     &tokens) < 0) {
+    report_tokenize_error();
+    token_vec_free(&tokens);
+    free(input_buffer);
+    return EXIT_FAILURE;
+  }
+
+  printf("Tokens:\n");
+
+  for (size_t i = 0; i < tokens.count; i++) {
+    const token_span_t *token = &tokens.spans[i];
+    printf("%.*s\n", (int)token->length, text + token->offset);
+  }
+
+  token_vec_free(&tokens);
+  if (text != input_buffer) {
+    free(text);
+  }
+  free(input_buffer);
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------- stream: all of stdin in fixed-size blocks ---------- */
+
+// A token that runs into the end of a block is written without its newline
+// and `pending` is set; the next block either continues it (a span at
+// offset 0) or closes it. Only the block buffer is ever held, so a token can
+// be longer than the block.
+static int stream_block(const tokenizer_t *tokenizer, const char *block,
+                        size_t len, token_vec_t *tokens, outbuf_t *out,
+                        bool *pending) {
+  tokens->count = 0;
+  if (tokenize(tokenizer, block, len, tokens) < 0) {
+    return -1;
+  }
+
+  if (*pending && (tokens->count == 0 || tokens->spans[0].offset != 0)) {
+    if (outbuf_putc(out, '\n') < 0) {
+      return -1;
+    }
+    *pending = false;
+  }
+
+  for (size_t i = 0; i < tokens->count; i++) {
+    const token_span_t *token = &tokens->spans[i];
+    if (outbuf_write(out, block + token->offset, token->length) < 0) {
+      return -1;
+    }
+    *pending = token->offset + token->length == len;
+    if (!*pending && outbuf_putc(out, '\n') < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int run_stream_mode(const tokenizer_t *tokenizer) {
+  char *block = malloc(STREAM_READ_SIZE);
+  token_vec_t tokens;
+  outbuf_t out;
+  bool pending = false;
+  int status = EXIT_FAILURE;
+
+  token_vec_init(&tokens);
+  if (block == NULL || outbuf_init(&out, STDOUT_FILENO, STREAM_WRITE_SIZE)) {
+    perror("malloc");
+    free(block);
+    return EXIT_FAILURE;
+  }
+
+  while (1) {
+    ssize_t nread = read(STDIN_FILENO, block, STREAM_READ_SIZE);
+    if (nread < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("read");
+      goto done;
+    }
+    if (nread == 0) {
+      break;
+    }
+    if (stream_block(tokenizer, block, (size_t)nread, &tokens, &out,
+                     &pending) < 0) {
+      perror("write");
+      goto done;
+    }
+  }
+
+  if ((pending && outbuf_putc(&out, '\n') < 0) || outbuf_flush(&out) < 0) {
+    perror("write");
+    goto done;
+  }
+  status = EXIT_SUCCESS;
+
+done:
+  outbuf_destroy(&out);
+  token_vec_free(&tokens);
+  free(block);
+  return status;
+}
+
+/* ---------- file: mmap + N threads ---------- */
+
+static int write_chunks(const char *base, const token_chunk_t *chunks,
+                        size_t nchunks) {
+  outbuf_t out;
+  if (outbuf_init(&out, STDOUT_FILENO, STREAM_WRITE_SIZE) < 0) {
+    return -1;
+  }
+  for (size_t k = 0; k < nchunks; k++) {
+    const char *chunk = base + chunks[k].begin;
+    for (size_t i = 0; i < chunks[k].tokens.count; i++) {
+      const token_span_t *token = &chunks[k].tokens.spans[i];
+      if (outbuf_write(&out, chunk + token->offset, token->length) < 0 ||
+          outbuf_putc(&out, '\n') < 0) {
+        outbuf_destroy(&out);
+        return -1;
+      }
+    }
+  }
+  int rc = outbuf_flush(&out);
+  outbuf_destroy(&out);
+  return rc;
+}
+
+// Determinism check: the chunked spans, shifted back to file offsets, must
+// equal what one scalar pass over the whole file produces.
+static int verify_chunks(const char *delimiters, const char *base, size_t len,
+                         const token_chunk_t *chunks, size_t nchunks) {
+  tokenizer_t reference;
+  token_vec_t expected;
+  size_t n = 0;
+  int mismatch = 0;
+
+  tokenizer_init(&reference, delimiters, TOK_ISA_SCALAR);
+  token_vec_init(&expected);
+  if (tokenize(&reference, base, len, &expected) < 0) {
+    perror("tokenize failed");
+    return -1;
+  }
+  for (size_t k = 0; k < nchunks && !mismatch; k++) {
+    for (size_t i = 0; i < chunks[k].tokens.count; i++, n++) {
+      const token_span_t *got = &chunks[k].tokens.spans[i];
+      if (n >= expected.count ||
+          got->offset + chunks[k].begin != expected.spans[n].offset ||
+          got->length != expected.spans[n].length) {
+        mismatch = 1;
+        break;
+      }
+    }
+  }
+  if (!mismatch && n != expected.count) {
+    mismatch = 1;
+  }
+  if (mismatch) {
+    fprintf(stderr, "verify: mismatch at token %zu\n", n);
+  } else {
+    fprintf(stderr, "verify: %zu tokens match across %zu chunks\n", n,
+            nchunks);
+  }
+  token_vec_free(&expected);
+  return mismatch ? -1 : 0;
+}
+
+// Quoted input can't be split blindly (a delimiter may sit inside quotes),
+// so it is tokenized in one pass.
+static int write_quoted_file(const tokenizer_t *tokenizer, const char *base,
+                             size_t len) {
+  token_chunk_t whole = {.begin = 0, .end = len};
+  char *text;
+  token_vec_init(&whole.tokens);
+  if (tokenize_input(tokenizer, true, base, len, &text, &whole.tokens) < 0) {
+    report_tokenize_error();
+    token_vec_free(&whole.tokens);
+    return -1;
+  }
+  int rc = write_chunks(text, &whole, 1);
+  if (rc < 0) {
+    perror("write");
+  }
+  token_vec_free(&whole.tokens);
+  free(text);
+  return rc;
+}
+
+static int run_file_mode(const tokenizer_t *tokenizer, const char *delimiters,
+                         const char *path, size_t nthreads, bool verify,
+                         bool binary, bool quoted) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return EXIT_FAILURE;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror("fstat");
+    close(fd);
+    return EXIT_FAILURE;
+  }
+
+  size_t len = (size_t)st.st_size;
+  const char *base = "";
+  if (len > 0) {
+    base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+      perror("mmap");
+      close(fd);
+      return EXIT_FAILURE;
+    }
+    (void)posix_madvise((void *)base, len, POSIX_MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  token_chunk_t chunks[MAX_THREADS];
+  int status = EXIT_FAILURE;
+  if (quoted) {
+    if (write_quoted_file(tokenizer, base, len) == 0) {
+      status = EXIT_SUCCESS;
+    }
+  } else if (tokenize_parallel(tokenizer, base, len, chunks, nthreads) < 0) {
+    perror("tokenize failed");
+  } else {
+    if (verify) {
+      if (verify_chunks(delimiters, base, len, chunks, nthreads) == 0) {
+        status = EXIT_SUCCESS;
+      }
+    } else if ((binary ? write_chunk_index(STDOUT_FILENO, len, chunks,
+                                           nthreads)
+                       : write_chunks(base, chunks, nthreads)) < 0) {
+      perror("write");
+    } else {
+      status = EXIT_SUCCESS;
+    }
+    free_chunks(chunks, nthreads);
+  }
+
+  if (len > 0) {
+    munmap((void *)base, len);
+  }
+  return status;
+}
+
+int main(int argc, char *argv[]) {
+  const char *delimiters = NULL;
+  bool quoted = false;
+  bool stream = false;
+  bool verify = false;
+  bool binary = false;
+  long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:qsj:Vb")) != -1) {
+    switch (opt) {
+    case 'd':
+      delimiters = optarg;
+      break;
+    case 'q':
+      quoted = true;
+      break;
+    case 's':
+      stream = true;
+      break;
+    case 'j':
+      nthreads = strtol(optarg, NULL, 10);
+      if (nthreads < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'V':
+      verify = true;
+      break;
+    case 'b':
+      binary = true;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (delimiters == NULL) {
+    delimiters = quoted ? " \t\n" : " ";
+  }
+  if (quoted && (stream || verify || binary)) {
+    fprintf(stderr, "-q can't be combined with -s, -V or -b\n");
+    return EXIT_FAILURE;
+  }
+
+  tokenizer_t tokenizer;
+  if (tokenizer_init(&tokenizer, delimiters, TOK_ISA_AUTO) < 0) {
+    fprintf(stderr, "tokenizer_init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  if (optind < argc) {
+    if (nthreads < 1) {
+      nthreads = 1;
+    } else if (nthreads > MAX_THREADS) {
+      nthreads = MAX_THREADS;
+    }
+    return run_file_mode(&tokenizer, delimiters, argv[optind],
+                         (size_t)nthreads, verify, binary, quoted);
+  }
+  if (binary) {
+    fprintf(stderr, "-b needs a file argument: index offsets point into it\n");
+    return EXIT_FAILURE;
+  }
+  return stream ? run_stream_mode(&tokenizer)
+                : run_line_mode(&tokenizer, quoted);
+}
@@ -0,0 +1,76 @@
+// Lab 1 - buffered bulk output over write(2)/writev(2)
+#define _POSIX_C_SOURCE 200809L
+#include "outbuf.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+int outbuf_init(outbuf_t *ob, int fd, size_t capacity) {
+  ob->fd = fd;
+  ob->used = 0;
+  ob->capacity = capacity;
+  ob->data = malloc(capacity);
+  return ob->data == NULL ? -1 : 0;
+}
+
+void outbuf_destroy(outbuf_t *ob) {
+  free(ob->data);
+  ob->data = NULL;
+  ob->used = 0;
+  ob->capacity = 0;
+}
+
+// writev until every byte of iov[0..cnt) is out, retrying short writes.
+static int writev_all(int fd, struct iovec *iov, int cnt) {
+  while (cnt > 0) {
+    ssize_t n = writev(fd, iov, cnt);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    while (cnt > 0 && (size_t)n >= iov->iov_len) {
+      n -= (ssize_t)iov->iov_len;
+      iov++;
+      cnt--;
+    }
+    if (cnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + n;
+      iov->iov_len -= (size_t)n;
+    }
+  }
+  return 0;
+}
+
+int outbuf_flush(outbuf_t *ob) {
+  struct iovec iov = {.iov_base = ob->data, .iov_len = ob->used};
+  ob->used = 0;
+  return writev_all(ob->fd, &iov, 1);
+}
+
+int outbuf_write(outbuf_t *ob, const void *data, size_t len) {
+  if (len <= ob->capacity - ob->used) {
+    memcpy(ob->data + ob->used, data, len);
+    ob->used += len;
+    return 0;
+  }
+  if (len < ob->capacity) {
+    if (outbuf_flush(ob) < 0) {
+      return -1;
+    }
+    memcpy(ob->data, data, len);
+    ob->used = len;
+    return 0;
+  }
+  // Too big to stage: send the queued bytes and the payload together.
+  struct iovec iov[2] = {
+      {.iov_base = ob->data, .iov_len = ob->used},
+      {.iov_base = (void *)data, .iov_len = len},
+  };
+  ob->used = 0;
+  return writev_all(ob->fd, iov, 2);
+}
@@ -0,0 +1,102 @@
+// Lab 1 - multi-threaded tokenization of an in-memory (mmap'd) buffer
+#include "parallel.h"
+
+#include <errno.h>
+#include <pthread.h>
+
+/* ---------- boundary fixup ---------- */
+
+void split_chunks(const tokenizer_t *tok, const char *buf, size_t len,
+                  token_chunk_t *chunks, size_t nchunks) {
+  const unsigned char *p = (const unsigned char *)buf;
+  size_t prev_end = 0;
+
+  for (size_t k = 0; k < nchunks; k++) {
+    size_t end = len;
+    if (k + 1 < nchunks) {
+      // Start from the even split point and slide forward onto the next
+      // delimiter; the token under the split point stays in this chunk.
+      end = len / nchunks * (k + 1);
+      if (end < prev_end) {
+        end = prev_end;
+      }
+      while (end < len && !tok->is_delim[p[end]]) {
+        end++;
+      }
+    }
+    chunks[k].begin = prev_end;
+    chunks[k].end = end;
+    token_vec_init(&chunks[k].tokens);
+    prev_end = end;
+  }
+}
+
+/* ---------- workers ---------- */
+
+typedef struct {
+  const tokenizer_t *tok;
+  const char *buf;
+  token_chunk_t *chunk;
+  int err; /* errno from tokenize(), 0 on success */
+} chunk_job_t;
+
+static void *tokenize_chunk(void *arg) {
+  chunk_job_t *job = arg;
+  token_chunk_t *chunk = job->chunk;
+  job->err = 0;
+  if (tokenize(job->tok, job->buf + chunk->begin, chunk->end - chunk->begin,
+               &chunk->tokens) < 0) {
+    job->err = errno;
+  }
+  return NULL;
+}
+
+int tokenize_parallel(const tokenizer_t *tok, const char *buf, size_t len,
+                      token_chunk_t *chunks, size_t nchunks) {
+  chunk_job_t jobs[nchunks];
+  pthread_t threads[nchunks];
+  size_t started = 0;
+  int err = 0;
+
+  split_chunks(tok, buf, len, chunks, nchunks);
+
+  // The calling thread takes chunk 0 itself.
+  for (size_t k = 0; k < nchunks; k++) {
+    jobs[k] = (chunk_job_t){.tok = tok, .buf = buf, .chunk = &chunks[k]};
+  }
+  for (size_t k = 1; k < nchunks; k++) {
+    int rc = pthread_create(&threads[k], NULL, tokenize_chunk, &jobs[k]);
+    if (rc != 0) {
+      // Fall back to running the rest inline.
+      for (size_t j = k; j < nchunks; j++) {
+        tokenize_chunk(&jobs[j]);
+      }
+      break;
+    }
+    started = k;
+  }
+  if (nchunks > 0) {
+    tokenize_chunk(&jobs[0]);
+  }
+  for (size_t k = 1; k <= started; k++) {
+    pthread_join(threads[k], NULL);
+  }
+
+  for (size_t k = 0; k < nchunks; k++) {
+    if (jobs[k].err != 0 && err == 0) {
+      err = jobs[k].err;
+    }
+  }
+  if (err != 0) {
+    free_chunks(chunks, nchunks);
+    errno = err;
+    return -1;
+  }
+  return 0;
+}
+
+void free_chunks(token_chunk_t *chunks, size_t nchunks) {
+  for (size_t k = 0; k < nchunks; k++) {
+    token_vec_free(&chunks[k].tokens);
+  }
+}
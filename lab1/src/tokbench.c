@@ -0,0 +1,320 @@
+// Lab 1 - tokenizer benchmark over generated corpora
+//
+// Runs the original strtok_r loop and every tokenizer engine over each
+// corpus and writes one CSV row per (corpus, engine): best-of-N time,
+// GB/s, tokens/s and cycles/byte. Corpora come from a fixed seed, so rows
+// from two builds are directly comparable.
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tokenizer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define DELIMS " \n"
+#define DEFAULT_MIB 64
+#define DEFAULT_REPS 5
+
+/* ---------- corpora ---------- */
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+  // xorshift64*: fixed seed, same bytes on every run.
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t rng_range(size_t lo, size_t hi) {
+  return lo + (size_t)(rng() % (hi - lo + 1));
+}
+
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t cap;
+  size_t line; /* bytes since the last newline */
+} corpus_t;
+
+static void put_word(corpus_t *c, size_t n, size_t line_width) {
+  for (size_t i = 0; i < n && c->len < c->cap; i++) {
+    c->buf[c->len++] = (char)('a' + rng() % 26);
+  }
+  c->line += n;
+  if (c->len < c->cap) {
+    int newline = line_width != 0 && c->line >= line_width;
+    c->buf[c->len++] = newline ? '\n' : ' ';
+    if (newline) {
+      c->line = 0;
+    }
+  }
+}
+
+static void gen_short_words(corpus_t *c) {
+  while (c->len < c->cap) {
+    put_word(c, rng_range(1, 8), 80);
+  }
+}
+
+static void gen_long_tokens(corpus_t *c) {
+  while (c->len < c->cap) {
+    put_word(c, rng_range(200, 2000), 4096);
+  }
+}
+
+static void gen_delim_heavy(corpus_t *c) {
+  while (c->len < c->cap) {
+    size_t run = rng_range(1, 10);
+    for (size_t i = 0; i < run && c->len < c->cap; i++) {
+      c->buf[c->len++] = (rng() & 7) ? ' ' : '\n';
+    }
+    if (c->len < c->cap) {
+      put_word(c, rng_range(1, 2), 0);
+    }
+  }
+}
+
+static void gen_huge_line(corpus_t *c) {
+  while (c->len < c->cap) {
+    put_word(c, rng_range(1, 16), 0);
+  }
+}
+
+static void gen_utf8(corpus_t *c) {
+  static const char *const words[] = {
+      "naïve", "café",      "Größe",  "日本語", "テキスト", "Привет",
+      "мир",   "שלום",      "مرحبا",  "🙂",     "数据",     "façade",
+      "ελλά",  "résumé",    "Ångström", "中文",   "한국어",   "😀🙃",
+  };
+  const size_t nwords = sizeof(words) / sizeof(words[0]);
+  while (c->len < c->cap) {
+    const char *w = words[rng() % nwords];
+    size_t n = strlen(w);
+    if (c->len + n + 1 > c->cap) {
+      break;
+    }
+    memcpy(c->buf + c->len, w, n);
+    c->len += n;
+    c->line += n;
+    c->buf[c->len++] = c->line >= 80 ? '\n' : ' ';
+    if (c->line >= 80) {
+      c->line = 0;
+    }
+  }
+}
+
+typedef struct {
+  const char *name;
+  void (*generate)(corpus_t *);
+} corpus_kind_t;
+
+static const corpus_kind_t corpora[] = {
+    {"short_words", gen_short_words}, {"long_tokens", gen_long_tokens},
+    {"delim_heavy", gen_delim_heavy}, {"huge_line", gen_huge_line},
+    {"utf8", gen_utf8},
+};
+
+/* ---------- engines ---------- */
+
+typedef struct {
+  const char *name;
+  tok_isa_t isa;  /* TOK_ISA_AUTO for the non-engine entries */
+  int kind;       /* ENGINE_* */
+} engine_t;
+
+enum { ENGINE_STRTOK, ENGINE_SPANS, ENGINE_QUOTED };
+
+static const engine_t engines[] = {
+    {"strtok_r", TOK_ISA_AUTO, ENGINE_STRTOK},
+    {"scalar", TOK_ISA_SCALAR, ENGINE_SPANS},
+    {"sse2", TOK_ISA_SSE2, ENGINE_SPANS},
+    {"avx2", TOK_ISA_AVX2, ENGINE_SPANS},
+    {"quoted_scalar", TOK_ISA_SCALAR, ENGINE_QUOTED},
+    {"quoted_sse2", TOK_ISA_SSE2, ENGINE_QUOTED},
+    {"quoted_avx2", TOK_ISA_AVX2, ENGINE_QUOTED},
+};
+
+typedef struct {
+  double seconds;
+  uint64_t cycles;
+  size_t tokens;
+} run_result_t;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// The original lab1 loop; it writes NULs, so it runs on a fresh copy that is
+// made outside the timed region.
+static size_t run_strtok(char *copy) {
+  size_t count = 0;
+  char *ctx;
+  for (char *t = strtok_r(copy, DELIMS, &ctx); t != NULL;
+       t = strtok_r(NULL, DELIMS, &ctx)) {
+    count++;
+  }
+  return count;
+}
+
+static int run_once(const engine_t *e, const tokenizer_t *tok,
+                    const corpus_t *c, char *scratch, token_vec_t *spans,
+                    run_result_t *r) {
+  if (e->kind == ENGINE_STRTOK) {
+    memcpy(scratch, c->buf, c->len);
+    scratch[c->len] = '\0';
+  }
+  spans->count = 0;
+
+  double t0 = now_seconds();
+  uint64_t c0 = now_cycles();
+  int rc = 0;
+  switch (e->kind) {
+  case ENGINE_STRTOK:
+    r->tokens = run_strtok(scratch);
+    break;
+  case ENGINE_SPANS:
+    rc = tokenize(tok, c->buf, c->len, spans);
+    r->tokens = spans->count;
+    break;
+  default:
+    rc = tokenize_quoted(tok, c->buf, c->len, scratch, spans);
+    r->tokens = spans->count;
+    break;
+  }
+  r->cycles = now_cycles() - c0;
+  r->seconds = now_seconds() - t0;
+  return rc;
+}
+
+/* ---------- driver ---------- */
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-m MiB] [-r reps] [-l label] [-o results.csv]\n"
+          "  -m  corpus size in MiB (default %d)\n"
+          "  -r  repetitions per engine, best one reported (default %d)\n"
+          "  -l  build label written to every row (default \"dev\")\n"
+          "  -o  append CSV rows to this file instead of stdout\n",
+          prog, DEFAULT_MIB, DEFAULT_REPS);
+}
+
+int main(int argc, char *argv[]) {
+  size_t mib = DEFAULT_MIB;
+  int reps = DEFAULT_REPS;
+  const char *label = "dev";
+  const char *csv_path = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "m:r:l:o:")) != -1) {
+    switch (opt) {
+    case 'm':
+      mib = strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      reps = atoi(optarg);
+      break;
+    case 'l':
+      label = optarg;
+      break;
+    case 'o':
+      csv_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (mib == 0 || reps < 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *csv = stdout;
+  if (csv_path != NULL) {
+    csv = fopen(csv_path, "a");
+    if (csv == NULL) {
+      perror(csv_path);
+      return EXIT_FAILURE;
+    }
+  }
+
+  corpus_t corpus = {.cap = mib << 20};
+  corpus.buf = malloc(corpus.cap);
+  char *scratch = malloc(corpus.cap + 1);
+  if (corpus.buf == NULL || scratch == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  token_vec_t spans;
+  token_vec_init(&spans);
+
+  if (csv_path == NULL || ftell(csv) == 0) {
+    fprintf(csv, "label,corpus,engine,bytes,tokens,reps,best_seconds,"
+                 "gb_per_s,tokens_per_s,cycles_per_byte\n");
+  }
+
+  for (size_t k = 0; k < sizeof(corpora) / sizeof(corpora[0]); k++) {
+    corpus.len = 0;
+    corpus.line = 0;
+    corpora[k].generate(&corpus);
+
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+      tokenizer_t tok;
+      if (tokenizer_init(&tok, DELIMS, engines[e].isa) < 0) {
+        continue; /* engine not supported on this CPU */
+      }
+
+      run_result_t best = {0};
+      for (int r = 0; r < reps; r++) {
+        run_result_t res;
+        if (run_once(&engines[e], &tok, &corpus, scratch, &spans, &res) < 0) {
+          perror(engines[e].name);
+          return EXIT_FAILURE;
+        }
+        if (r == 0 || res.seconds < best.seconds) {
+          best = res;
+        }
+      }
+
+      double secs = best.seconds > 0 ? best.seconds : 1e-9;
+      fprintf(csv, "%s,%s,%s,%zu,%zu,%d,%.6f,%.3f,%.0f,", label,
+              corpora[k].name, engines[e].name, corpus.len, best.tokens, reps,
+              best.seconds, (double)corpus.len / secs / 1e9,
+              (double)best.tokens / secs);
+      if (best.cycles != 0) {
+        fprintf(csv, "%.3f\n", (double)best.cycles / (double)corpus.len);
+      } else {
+        fprintf(csv, "\n"); /* no cycle counter on this architecture */
+      }
+      fflush(csv);
+    }
+  }
+
+  token_vec_free(&spans);
+  free(scratch);
+  free(corpus.buf);
+  if (csv != stdout) {
+    fclose(csv);
+  }
+  return EXIT_SUCCESS;
+}
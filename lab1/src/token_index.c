@@ -0,0 +1,80 @@
+// Lab 1 - binary token index (writer helpers + mmap reader)
+#define _POSIX_C_SOURCE 200809L
+#include "token_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void token_index_header_init(token_index_header_t *hdr, uint64_t token_count,
+                             uint64_t input_size) {
+  memset(hdr, 0, sizeof(*hdr));
+  memcpy(hdr->magic, TOKEN_INDEX_MAGIC, sizeof(hdr->magic));
+  hdr->version = TOKEN_INDEX_VERSION;
+  hdr->entry_size = sizeof(token_index_entry_t);
+  hdr->token_count = token_count;
+  hdr->input_size = input_size;
+}
+
+// Reject anything whose header does not describe exactly this file. Entries
+// are not walked here, so opening stays O(1) regardless of token count.
+static int validate(const token_index_header_t *hdr, size_t size) {
+  if (size < sizeof(*hdr) ||
+      memcmp(hdr->magic, TOKEN_INDEX_MAGIC, sizeof(hdr->magic)) != 0 ||
+      hdr->version != TOKEN_INDEX_VERSION ||
+      hdr->entry_size != sizeof(token_index_entry_t)) {
+    return -1;
+  }
+  size_t body = size - sizeof(*hdr);
+  if (hdr->token_count != body / sizeof(token_index_entry_t) ||
+      body % sizeof(token_index_entry_t) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+int token_index_open(token_index_t *idx, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return -1;
+  }
+  size_t size = (size_t)st.st_size;
+  if (size < sizeof(token_index_header_t)) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  if (validate(map, size) < 0) {
+    munmap(map, size);
+    errno = EINVAL;
+    return -1;
+  }
+
+  idx->header = map;
+  idx->entries = (const token_index_entry_t *)(idx->header + 1);
+  idx->map_size = size;
+  return 0;
+}
+
+void token_index_close(token_index_t *idx) {
+  if (idx->header != NULL) {
+    munmap((void *)idx->header, idx->map_size);
+  }
+  idx->header = NULL;
+  idx->entries = NULL;
+  idx->map_size = 0;
+}
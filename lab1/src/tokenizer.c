@@ -0,0 +1,554 @@
+// Lab 1 - zero-copy delimiter tokenizer (scalar / SSE2 / AVX2)
+#include "tokenizer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TOK_X86 1
+#include <immintrin.h>
+#endif
+
+#define BLOCK 64
+
+/* ---------- span vector ---------- */
+
+void token_vec_init(token_vec_t *vec) {
+  vec->spans = NULL;
+  vec->count = 0;
+  vec->capacity = 0;
+}
+
+void token_vec_free(token_vec_t *vec) {
+  free(vec->spans);
+  token_vec_init(vec);
+}
+
+static int token_vec_grow(token_vec_t *vec) {
+  size_t capacity = vec->capacity ? vec->capacity * 2 : 1024;
+  token_span_t *spans = realloc(vec->spans, capacity * sizeof(*spans));
+  if (spans == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  vec->spans = spans;
+  vec->capacity = capacity;
+  return 0;
+}
+
+static inline int token_vec_push(token_vec_t *vec, size_t offset,
+                                 size_t length) {
+  if (vec->count == vec->capacity && token_vec_grow(vec) < 0) {
+    return -1;
+  }
+  vec->spans[vec->count].offset = offset;
+  vec->spans[vec->count].length = length;
+  vec->count++;
+  return 0;
+}
+
+/* ---------- delimiter masks (bit i set = p[i] is a delimiter) ---------- */
+
+static inline uint64_t mask64_scalar(const tokenizer_t *tok,
+                                     const uint8_t *p) {
+  uint64_t mask = 0;
+  for (int i = 0; i < BLOCK; i++) {
+    mask |= (uint64_t)tok->is_delim[p[i]] << i;
+  }
+  return mask;
+}
+
+#ifdef TOK_X86
+__attribute__((target("sse2"))) static inline uint64_t
+mask64_sse2(const tokenizer_t *tok, const uint8_t *p) {
+  __m128i v0 = _mm_loadu_si128((const __m128i *)(p + 0));
+  __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+  __m128i v2 = _mm_loadu_si128((const __m128i *)(p + 32));
+  __m128i v3 = _mm_loadu_si128((const __m128i *)(p + 48));
+  __m128i m0 = _mm_setzero_si128(), m1 = m0, m2 = m0, m3 = m0;
+  for (size_t d = 0; d < tok->num_delims; d++) {
+    __m128i c = _mm_set1_epi8((char)tok->delims[d]);
+    m0 = _mm_or_si128(m0, _mm_cmpeq_epi8(v0, c));
+    m1 = _mm_or_si128(m1, _mm_cmpeq_epi8(v1, c));
+    m2 = _mm_or_si128(m2, _mm_cmpeq_epi8(v2, c));
+    m3 = _mm_or_si128(m3, _mm_cmpeq_epi8(v3, c));
+  }
+  return (uint64_t)(uint16_t)_mm_movemask_epi8(m0) |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(m1) << 16 |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(m2) << 32 |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(m3) << 48;
+}
+
+__attribute__((target("avx2"))) static inline uint64_t
+mask64_avx2(const tokenizer_t *tok, const uint8_t *p) {
+  __m256i v0 = _mm256_loadu_si256((const __m256i *)(p + 0));
+  __m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+  __m256i m0 = _mm256_setzero_si256(), m1 = m0;
+  for (size_t d = 0; d < tok->num_delims; d++) {
+    __m256i c = _mm256_set1_epi8((char)tok->delims[d]);
+    m0 = _mm256_or_si256(m0, _mm256_cmpeq_epi8(v0, c));
+    m1 = _mm256_or_si256(m1, _mm256_cmpeq_epi8(v1, c));
+  }
+  return (uint64_t)(uint32_t)_mm256_movemask_epi8(m0) |
+         (uint64_t)(uint32_t)_mm256_movemask_epi8(m1) << 32;
+}
+#endif
+
+/* ---------- quote-aware classification ---------- */
+
+/* Per-block bitmasks of the bytes the quoted scanner cares about. */
+typedef struct {
+  uint64_t delim;
+  uint64_t dquote;
+  uint64_t squote;
+  uint64_t bslash;
+} block_class_t;
+
+static inline block_class_t classify_scalar(const tokenizer_t *tok,
+                                            const uint8_t *p) {
+  block_class_t c = {0, 0, 0, 0};
+  for (int i = 0; i < BLOCK; i++) {
+    c.delim |= (uint64_t)tok->is_delim[p[i]] << i;
+    c.dquote |= (uint64_t)(p[i] == '"') << i;
+    c.squote |= (uint64_t)(p[i] == '\'') << i;
+    c.bslash |= (uint64_t)(p[i] == '\\') << i;
+  }
+  c.delim &= ~(c.dquote | c.squote | c.bslash);
+  return c;
+}
+
+#ifdef TOK_X86
+__attribute__((target("sse2"))) static inline uint64_t
+eq64_sse2(__m128i v0, __m128i v1, __m128i v2, __m128i v3, char ch) {
+  __m128i c = _mm_set1_epi8(ch);
+  return (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v0, c)) |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v1, c)) << 16 |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v2, c)) << 32 |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v3, c)) << 48;
+}
+
+__attribute__((target("sse2"))) static inline block_class_t
+classify_sse2(const tokenizer_t *tok, const uint8_t *p) {
+  __m128i v0 = _mm_loadu_si128((const __m128i *)(p + 0));
+  __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+  __m128i v2 = _mm_loadu_si128((const __m128i *)(p + 32));
+  __m128i v3 = _mm_loadu_si128((const __m128i *)(p + 48));
+  block_class_t c;
+  c.delim = mask64_sse2(tok, p);
+  c.dquote = eq64_sse2(v0, v1, v2, v3, '"');
+  c.squote = eq64_sse2(v0, v1, v2, v3, '\'');
+  c.bslash = eq64_sse2(v0, v1, v2, v3, '\\');
+  c.delim &= ~(c.dquote | c.squote | c.bslash);
+  return c;
+}
+
+__attribute__((target("avx2"))) static inline uint64_t
+eq64_avx2(__m256i v0, __m256i v1, char ch) {
+  __m256i c = _mm256_set1_epi8(ch);
+  return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, c)) |
+         (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, c))
+             << 32;
+}
+
+__attribute__((target("avx2"))) static inline block_class_t
+classify_avx2(const tokenizer_t *tok, const uint8_t *p) {
+  __m256i v0 = _mm256_loadu_si256((const __m256i *)(p + 0));
+  __m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+  block_class_t c;
+  c.delim = mask64_avx2(tok, p);
+  c.dquote = eq64_avx2(v0, v1, '"');
+  c.squote = eq64_avx2(v0, v1, '\'');
+  c.bslash = eq64_avx2(v0, v1, '\\');
+  c.delim &= ~(c.dquote | c.squote | c.bslash);
+  return c;
+}
+#endif
+
+/* ---------- block scan ---------- */
+
+// Turn one block's delimiter mask into spans. `prev` carries whether the byte
+// before this block was a delimiter; a token is open between a
+// delimiter->byte edge and the next byte->delimiter edge.
+static inline __attribute__((always_inline)) int
+emit_block(uint64_t delim, size_t base, uint64_t *prev, size_t *start,
+           token_vec_t *out) {
+  uint64_t edges = delim ^ ((delim << 1) | *prev);
+  *prev = delim >> 63;
+  while (edges != 0) {
+    int bit = __builtin_ctzll(edges);
+    size_t pos = base + (size_t)bit;
+    if (delim & (1ULL << bit)) {
+      if (token_vec_push(out, *start, pos - *start) < 0) {
+        return -1;
+      }
+    } else {
+      *start = pos;
+    }
+    edges &= edges - 1;
+  }
+  return 0;
+}
+
+// The tail (< 64 bytes) is classified with the lookup table; bytes past the
+// end count as delimiters so a token running into the end gets closed.
+static inline __attribute__((always_inline)) int
+scan_tail(const tokenizer_t *tok, const uint8_t *p, size_t i, size_t len,
+          uint64_t *prev, size_t *start, token_vec_t *out) {
+  uint64_t delim = ~0ULL;
+  for (size_t j = 0; i + j < len; j++) {
+    if (!tok->is_delim[p[i + j]]) {
+      delim &= ~(1ULL << j);
+    }
+  }
+  return emit_block(delim, i, prev, start, out);
+}
+
+#define DEFINE_SCAN(name, attr, mask_fn)                                       \
+  attr static int name(const tokenizer_t *tok, const uint8_t *p, size_t len,  \
+                       token_vec_t *out) {                                     \
+    uint64_t prev = 1; /* the byte before the buffer counts as a delimiter */ \
+    size_t start = 0;                                                          \
+    size_t i = 0;                                                              \
+    for (; i + BLOCK <= len; i += BLOCK) {                                     \
+      if (emit_block(mask_fn(tok, p + i), i, &prev, &start, out) < 0) {        \
+        return -1;                                                             \
+      }                                                                        \
+    }                                                                          \
+    return scan_tail(tok, p, i, len, &prev, &start, out);                      \
+  }
+
+DEFINE_SCAN(scan_scalar, , mask64_scalar)
+#ifdef TOK_X86
+DEFINE_SCAN(scan_sse2, __attribute__((target("sse2"))), mask64_sse2)
+DEFINE_SCAN(scan_avx2, __attribute__((target("avx2"))), mask64_avx2)
+#endif
+
+/* ---------- quote-aware block scan ---------- */
+
+enum { QS_NONE, QS_DQUOTE, QS_SQUOTE };
+
+typedef struct {
+  int state;    /* QS_*: quote open at the end of the previous block */
+  uint64_t esc; /* 1 if the first byte of the next block is escaped */
+} quote_state_t;
+
+// Bit i set = an odd number of quote bits at or below i, i.e. "inside".
+static inline uint64_t prefix_xor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Bytes preceded by an odd run of backslashes (simdjson's find_escaped).
+// `carry` is 1 on entry if bit 0 is escaped, and on exit if the byte after
+// this block is.
+static inline uint64_t find_escaped(uint64_t bslash, uint64_t *carry) {
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  bslash &= ~*carry;
+  uint64_t follows_escape = bslash << 1 | *carry;
+  uint64_t odd_starts = bslash & ~even_bits & ~follows_escape;
+  uint64_t even_sequences;
+  *carry = __builtin_add_overflow(odd_starts, bslash, &even_sequences);
+  uint64_t invert_mask = even_sequences << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+static inline int special_in_dquote(uint8_t c) {
+  return c == '"' || c == '\\';
+}
+
+// Byte-at-a-time reference: classifies p[0, n) (n <= 64, `avail` bytes
+// readable) into active delimiters and dropped bytes. Bits past n count as
+// delimiters.
+static inline void quote_block_scalar(const tokenizer_t *tok,
+                                      const uint8_t *p, size_t n,
+                                      size_t avail, quote_state_t *qs,
+                                      uint64_t *delim, uint64_t *drop) {
+  uint64_t d = 0, dr = 0;
+  for (size_t j = 0; j < n; j++) {
+    uint8_t c = p[j];
+    uint64_t bit = 1ULL << j;
+    if (qs->esc) {
+      qs->esc = 0;
+      continue;
+    }
+    switch (qs->state) {
+    case QS_NONE:
+      if (c == '\\') {
+        // A trailing backslash has nothing to escape and stays literal.
+        if (j + 1 < avail) {
+          dr |= bit;
+          qs->esc = 1;
+        }
+      } else if (c == '"') {
+        dr |= bit;
+        qs->state = QS_DQUOTE;
+      } else if (c == '\'') {
+        dr |= bit;
+        qs->state = QS_SQUOTE;
+      } else if (tok->is_delim[c]) {
+        d |= bit;
+      }
+      break;
+    case QS_SQUOTE:
+      if (c == '\'') {
+        dr |= bit;
+        qs->state = QS_NONE;
+      }
+      break;
+    default: /* QS_DQUOTE */
+      if (c == '"') {
+        dr |= bit;
+        qs->state = QS_NONE;
+      } else if (c == '\\' && j + 1 < avail && special_in_dquote(p[j + 1])) {
+        dr |= bit;
+        qs->esc = 1;
+      }
+      break;
+    }
+  }
+  if (n < BLOCK) {
+    d |= ~0ULL << n;
+  }
+  *delim = d;
+  *drop = dr;
+}
+
+// Bitmask paths for a full block. Handles blocks that only involve one
+// kind of quote (plus backslashes outside '...'); returns 0 when the block
+// mixes both so the caller falls back to quote_block_scalar().
+static inline __attribute__((always_inline)) int
+quote_block_fast(block_class_t c, const uint8_t *p, size_t avail,
+                 quote_state_t *qs, uint64_t *delim, uint64_t *drop) {
+  if (qs->state == QS_NONE && !qs->esc &&
+      (c.dquote | c.squote | c.bslash) == 0) {
+    *delim = c.delim;
+    *drop = 0;
+    return 1;
+  }
+
+  int has_next = avail > BLOCK;
+  if (qs->state != QS_SQUOTE) {
+    uint64_t carry = qs->esc;
+    uint64_t escaped = find_escaped(c.bslash, &carry);
+    uint64_t quotes = c.dquote & ~escaped;
+    uint64_t inside = prefix_xor(quotes);
+    if (qs->state == QS_DQUOTE) {
+      inside = ~inside;
+    }
+    // Any live single quote means a '...' region: not this path.
+    if ((c.squote & ~inside & ~escaped) == 0) {
+      if (!has_next) {
+        carry = 0;
+      }
+      // Escaping backslashes are dropped outside quotes; inside "..." only
+      // when they precede " or \.
+      uint64_t escapes = (escaped >> 1) | carry << 63;
+      uint64_t special_next = (c.dquote | c.bslash) >> 1;
+      if (has_next && special_in_dquote(p[BLOCK])) {
+        special_next |= 1ULL << 63;
+      }
+      *delim = c.delim & ~inside & ~escaped;
+      *drop = quotes | (escapes & c.bslash & (~inside | special_next));
+      qs->state = (inside >> 63) ? QS_DQUOTE : QS_NONE;
+      qs->esc = carry;
+      return 1;
+    }
+  }
+
+  if (qs->state != QS_DQUOTE && !qs->esc) {
+    uint64_t inside = prefix_xor(c.squote);
+    if (qs->state == QS_SQUOTE) {
+      inside = ~inside;
+    }
+    // Backslashes and double quotes are literal only inside '...'.
+    if (((c.bslash | c.dquote) & ~inside) == 0) {
+      *delim = c.delim & ~inside;
+      *drop = c.squote;
+      qs->state = (inside >> 63) ? QS_SQUOTE : QS_NONE;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Like emit_block(), but positions are in `text`. Every byte of p[0, n)
+// except dropped ones is copied (delimiters included, so a block without
+// quotes or escapes is one memcpy), and an input position maps to the count
+// of kept bytes before it.
+static inline __attribute__((always_inline)) int
+emit_quoted_block(const uint8_t *p, size_t n, uint64_t delim, uint64_t drop,
+                  char *text, size_t *w, uint64_t *prev, size_t *start,
+                  token_vec_t *out) {
+  uint64_t valid = n >= BLOCK ? ~0ULL : (1ULL << n) - 1;
+  uint64_t keep = ~drop & valid;
+  uint64_t edges = delim ^ ((delim << 1) | *prev);
+  size_t w0 = *w;
+  *prev = delim >> 63;
+
+  while (edges != 0) {
+    int bit = __builtin_ctzll(edges);
+    size_t pos = w0 + (drop == 0 ? (size_t)bit
+                                 : (size_t)__builtin_popcountll(
+                                       keep & ((1ULL << bit) - 1)));
+    if (delim & (1ULL << bit)) {
+      if (token_vec_push(out, *start, pos - *start) < 0) {
+        return -1;
+      }
+    } else {
+      *start = pos;
+    }
+    edges &= edges - 1;
+  }
+
+  if (keep == ~0ULL) {
+    memcpy(text + w0, p, BLOCK);
+    *w = w0 + BLOCK;
+    return 0;
+  }
+  // Copy the kept bytes run by run.
+  char *dst = text + w0;
+  uint64_t k = keep;
+  while (k != 0) {
+    int s = __builtin_ctzll(k);
+    uint64_t rest = ~(k >> s);
+    int run = rest ? __builtin_ctzll(rest) : BLOCK - s;
+    memcpy(dst, p + s, (size_t)run);
+    dst += run;
+    k = (s + run >= BLOCK) ? 0 : k & (~0ULL << (s + run));
+  }
+  *w = (size_t)(dst - text);
+  return 0;
+}
+
+#define DEFINE_QSCAN(name, attr, classify_fn)                                  \
+  attr static int name(const tokenizer_t *tok, const uint8_t *p, size_t len,  \
+                       char *text, token_vec_t *out) {                         \
+    quote_state_t qs = {QS_NONE, 0};                                           \
+    uint64_t prev = 1, delim, drop;                                            \
+    size_t start = 0, w = 0, i = 0;                                            \
+    for (; i + BLOCK <= len; i += BLOCK) {                                     \
+      if (!quote_block_fast(classify_fn(tok, p + i), p + i, len - i, &qs,     \
+                            &delim, &drop)) {                                  \
+        quote_block_scalar(tok, p + i, BLOCK, len - i, &qs, &delim, &drop);   \
+      }                                                                        \
+      if (emit_quoted_block(p + i, BLOCK, delim, drop, text, &w, &prev,       \
+                            &start, out) < 0) {                                \
+        return -1;                                                             \
+      }                                                                        \
+    }                                                                          \
+    quote_block_scalar(tok, p + i, len - i, len - i, &qs, &delim, &drop);     \
+    if (emit_quoted_block(p + i, len - i, delim, drop, text, &w, &prev,       \
+                          &start, out) < 0) {                                  \
+      return -1;                                                               \
+    }                                                                          \
+    if (qs.state != QS_NONE) {                                                 \
+      errno = EINVAL;                                                          \
+      return -1;                                                               \
+    }                                                                          \
+    return 0;                                                                  \
+  }
+
+DEFINE_QSCAN(qscan_scalar, , classify_scalar)
+#ifdef TOK_X86
+DEFINE_QSCAN(qscan_sse2, __attribute__((target("sse2,popcnt"))),
+             classify_sse2)
+DEFINE_QSCAN(qscan_avx2, __attribute__((target("avx2,popcnt"))),
+             classify_avx2)
+#endif
+
+/* ---------- public API ---------- */
+
+int tok_isa_supported(tok_isa_t isa) {
+  switch (isa) {
+  case TOK_ISA_AUTO:
+  case TOK_ISA_SCALAR:
+    return 1;
+#ifdef TOK_X86
+  case TOK_ISA_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case TOK_ISA_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return 0;
+  }
+}
+
+const char *tok_isa_name(tok_isa_t isa) {
+  switch (isa) {
+  case TOK_ISA_SCALAR:
+    return "scalar";
+  case TOK_ISA_SSE2:
+    return "sse2";
+  case TOK_ISA_AVX2:
+    return "avx2";
+  default:
+    return "auto";
+  }
+}
+
+int tokenizer_init(tokenizer_t *tok, const char *delims, tok_isa_t isa) {
+  memset(tok, 0, sizeof(*tok));
+  size_t distinct = 0;
+  for (const unsigned char *d = (const unsigned char *)delims; *d; d++) {
+    if (!tok->is_delim[*d]) {
+      tok->is_delim[*d] = 1;
+      if (distinct < TOK_MAX_SIMD_DELIMS) {
+        tok->delims[distinct] = *d;
+      }
+      distinct++;
+    }
+  }
+  tok->num_delims = distinct;
+
+  if (!tok_isa_supported(isa)) {
+    return -1;
+  }
+  if (isa == TOK_ISA_AUTO) {
+    isa = tok_isa_supported(TOK_ISA_AVX2)   ? TOK_ISA_AVX2
+          : tok_isa_supported(TOK_ISA_SSE2) ? TOK_ISA_SSE2
+                                            : TOK_ISA_SCALAR;
+  }
+  // Too many delimiters for the compare chain: use the table instead.
+  if (distinct > TOK_MAX_SIMD_DELIMS) {
+    isa = TOK_ISA_SCALAR;
+  }
+  tok->isa = isa;
+  return 0;
+}
+
+int tokenize(const tokenizer_t *tok, const char *buf, size_t len,
+             token_vec_t *out) {
+  const uint8_t *p = (const uint8_t *)buf;
+  switch (tok->isa) {
+#ifdef TOK_X86
+  case TOK_ISA_AVX2:
+    return scan_avx2(tok, p, len, out);
+  case TOK_ISA_SSE2:
+    return scan_sse2(tok, p, len, out);
+#endif
+  default:
+    return scan_scalar(tok, p, len, out);
+  }
+}
+
+int tokenize_quoted(const tokenizer_t *tok, const char *buf, size_t len,
+                    char *text, token_vec_t *out) {
+  const uint8_t *p = (const uint8_t *)buf;
+  switch (tok->isa) {
+#ifdef TOK_X86
+  case TOK_ISA_AVX2:
+    return qscan_avx2(tok, p, len, text, out);
+  case TOK_ISA_SSE2:
+    return qscan_sse2(tok, p, len, text, out);
+#endif
+  default:
+    return qscan_scalar(tok, p, len, text, out);
+  }
+}
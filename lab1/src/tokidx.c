@@ -0,0 +1,292 @@
+// Lab 1 - print tokens from a binary token index (lab1 -b) and its input
+//
+// With no token number the output is the same text lab1 prints for the
+// input, one token per line, so the two can be diffed for a round trip.
+//
+// -V instead checks that round trip without any files: generated inputs
+// (and edge cases: empty, all delimiters, block-sized) are tokenized on
+// several threads, written through lab1's index writer to a memfd, mapped
+// back with token_index_open() and compared, header and every entry, with
+// one scalar tokenize() pass over the input. Exits non-zero on the first
+// difference.
+#define _GNU_SOURCE // memfd_create
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chunk_index.h"
+#include "outbuf.h"
+#include "parallel.h"
+#include "token_index.h"
+#include "tokenizer.h"
+
+#define WRITE_SIZE (1 << 20)
+#define DELIMS " \n\t"
+#define DEFAULT_MIB 4
+#define MAX_CHUNKS 8
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s index input [token-number]\n", prog);
+  fprintf(stderr, "       %s -V [-m MiB]\n", prog);
+  fprintf(stderr, "  -V  round-trip generated inputs through the index "
+                  "writer and reader\n");
+  fprintf(stderr, "  -m  size of the largest generated input (default %d)\n",
+          DEFAULT_MIB);
+}
+
+static int print_token(outbuf_t *out, const char *input, size_t input_size,
+                       token_index_entry_t entry) {
+  if (entry.offset > input_size || entry.length > input_size - entry.offset) {
+    fprintf(stderr, "token out of range of input\n");
+    return -1;
+  }
+  if (outbuf_write(out, input + entry.offset, entry.length) < 0 ||
+      outbuf_putc(out, '\n') < 0) {
+    perror("write");
+    return -1;
+  }
+  return 0;
+}
+
+/* ---------- round-trip check ---------- */
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+  // xorshift64*: fixed seed, same inputs on every run.
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Words of 1-16 letters between runs of 1-3 delimiters; `delims_only`
+// leaves out the words.
+static void generate(char *buf, size_t len, int delims_only) {
+  size_t i = 0;
+  while (i < len) {
+    size_t word = delims_only ? 0 : 1 + rng() % 16;
+    for (size_t j = 0; j < word && i < len; j++) {
+      buf[i++] = (char)('a' + rng() % 26);
+    }
+    size_t run = 1 + rng() % 3;
+    for (size_t j = 0; j < run && i < len; j++) {
+      buf[i++] = DELIMS[rng() % (sizeof(DELIMS) - 1)];
+    }
+  }
+}
+
+// Write the index for buf[0, len) split `nchunks` ways, read it back and
+// compare it with `expected`. Returns 0, or -1 after saying what differed.
+static int round_trip(const tokenizer_t *tok, const char *buf, size_t len,
+                      size_t nchunks, const token_vec_t *expected) {
+  token_chunk_t chunks[MAX_CHUNKS];
+  if (tokenize_parallel(tok, buf, len, chunks, nchunks) < 0) {
+    perror("tokenize_parallel");
+    return -1;
+  }
+  int fd = memfd_create("tokidx", 0);
+  if (fd < 0) {
+    perror("memfd_create");
+    free_chunks(chunks, nchunks);
+    return -1;
+  }
+  int rc = write_chunk_index(fd, len, chunks, nchunks);
+  free_chunks(chunks, nchunks);
+  if (rc < 0) {
+    perror("write_chunk_index");
+    close(fd);
+    return -1;
+  }
+
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+  token_index_t idx;
+  rc = token_index_open(&idx, path);
+  close(fd);
+  if (rc < 0) {
+    perror("token_index_open");
+    return -1;
+  }
+  const char *what = NULL;
+  uint64_t n = 0;
+  if (token_index_input_size(&idx) != len) {
+    what = "input size";
+  } else if (token_index_count(&idx) != expected->count) {
+    what = "token count";
+  } else {
+    for (; n < expected->count; n++) {
+      token_index_entry_t got = token_index_get(&idx, n);
+      if (got.offset != expected->spans[n].offset ||
+          got.length != expected->spans[n].length) {
+        what = "entry";
+        break;
+      }
+    }
+  }
+  token_index_close(&idx);
+  if (what != NULL) {
+    fprintf(stderr, "verify: %zu-byte input on %zu chunks: %s differs "
+                    "(token %llu)\n",
+            len, nchunks, what, (unsigned long long)n);
+    return -1;
+  }
+  return 0;
+}
+
+static int verify(size_t max_len) {
+  // Empty, tiny, around one and two 64-byte blocks, then growing to max_len
+  size_t lens[] = {0, 1, 2, 63, 64, 65, 127, 128, 129, 4099, 65536 + 7,
+                   max_len};
+  size_t nchunks[] = {1, 3, MAX_CHUNKS};
+  tokenizer_t tok, reference;
+  tokenizer_init(&tok, DELIMS, TOK_ISA_AUTO);
+  tokenizer_init(&reference, DELIMS, TOK_ISA_SCALAR);
+  char *buf = malloc(max_len > 0 ? max_len : 1);
+  if (buf == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  size_t cases = 0;
+  int status = EXIT_SUCCESS;
+  for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+    size_t len = lens[l] < max_len ? lens[l] : max_len;
+    for (int delims_only = 0; delims_only <= 1; delims_only++) {
+      generate(buf, len, delims_only);
+      token_vec_t expected;
+      token_vec_init(&expected);
+      if (tokenize(&reference, buf, len, &expected) < 0) {
+        perror("tokenize");
+        token_vec_free(&expected);
+        free(buf);
+        return EXIT_FAILURE;
+      }
+      for (size_t c = 0; c < sizeof(nchunks) / sizeof(nchunks[0]); c++) {
+        if (round_trip(&tok, buf, len, nchunks[c], &expected) < 0) {
+          status = EXIT_FAILURE;
+        }
+        cases++;
+      }
+      token_vec_free(&expected);
+      if (status != EXIT_SUCCESS) {
+        free(buf);
+        return status;
+      }
+    }
+  }
+  free(buf);
+  printf("verify: %zu index round trips match the tokenizer\n", cases);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  const char *prog = argv[0];
+  int check = 0;
+  size_t mib = DEFAULT_MIB;
+  int opt;
+  while ((opt = getopt(argc, argv, "Vm:")) != -1) {
+    switch (opt) {
+    case 'V':
+      check = 1;
+      break;
+    case 'm':
+      mib = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      usage(prog);
+      return EXIT_FAILURE;
+    }
+  }
+  if (check) {
+    if (optind != argc || mib == 0) {
+      usage(prog);
+      return EXIT_FAILURE;
+    }
+    return verify(mib << 20);
+  }
+  argc -= optind - 1; // argv[1] is now the first operand
+  argv += optind - 1;
+  if (argc != 3 && argc != 4) {
+    usage(prog);
+    return EXIT_FAILURE;
+  }
+
+  token_index_t idx;
+  if (token_index_open(&idx, argv[1]) < 0) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  int fd = open(argv[2], O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    perror(argv[2]);
+    token_index_close(&idx);
+    return EXIT_FAILURE;
+  }
+  size_t input_size = (size_t)st.st_size;
+  if (input_size != token_index_input_size(&idx)) {
+    fprintf(stderr, "%s: index was built for a %llu-byte input\n", argv[2],
+            (unsigned long long)token_index_input_size(&idx));
+    close(fd);
+    token_index_close(&idx);
+    return EXIT_FAILURE;
+  }
+  const char *input = "";
+  if (input_size > 0) {
+    input = mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (input == MAP_FAILED) {
+      perror("mmap");
+      close(fd);
+      token_index_close(&idx);
+      return EXIT_FAILURE;
+    }
+  }
+  close(fd);
+
+  outbuf_t out;
+  int status = EXIT_FAILURE;
+  if (outbuf_init(&out, STDOUT_FILENO, WRITE_SIZE) < 0) {
+    perror("malloc");
+    goto done;
+  }
+
+  if (argc == 4) {
+    char *end;
+    unsigned long long n = strtoull(argv[3], &end, 10);
+    if (*end != '\0' || n >= token_index_count(&idx)) {
+      fprintf(stderr, "token number out of range (index has %llu tokens)\n",
+              (unsigned long long)token_index_count(&idx));
+      goto done_out;
+    }
+    if (print_token(&out, input, input_size, token_index_get(&idx, n)) < 0) {
+      goto done_out;
+    }
+  } else {
+    for (uint64_t n = 0; n < token_index_count(&idx); n++) {
+      if (print_token(&out, input, input_size, token_index_get(&idx, n)) < 0) {
+        goto done_out;
+      }
+    }
+  }
+  if (outbuf_flush(&out) < 0) {
+    perror("write");
+    goto done_out;
+  }
+  status = EXIT_SUCCESS;
+
+done_out:
+  outbuf_destroy(&out);
+done:
+  if (input_size > 0) {
+    munmap((void *)input, input_size);
+  }
+  token_index_close(&idx);
+  return status;
+}
@@ -0,0 +1,26 @@
+// Lab 2 - commands that run inside the runner, with no fork/exec
+#ifndef LAB2_BUILTINS_H
+#define LAB2_BUILTINS_H
+
+#include <stdbool.h>
+
+/* State a builtin can change besides the process (cwd) itself. */
+typedef struct {
+  bool exit_requested;
+  int exit_status;
+  bool cwd_changed; /* set by cd; cleared by the runner once handled */
+} builtin_env_t;
+
+/* Runs with argv[0] == the builtin's name; returns its exit status. */
+typedef int (*builtin_fn)(char **argv, builtin_env_t *env);
+
+typedef struct {
+  const char *name;
+  builtin_fn run;
+  bool blocks; /* takes real time (sleep): keep it out of the job loop */
+} builtin_t;
+
+/* The builtin called `name`, or NULL if it is an external program. */
+const builtin_t *builtin_find(const char *name);
+
+#endif
@@ -0,0 +1,52 @@
+// Lab 2 - bounded pool of background jobs, reaped through pidfds
+#ifndef LAB2_JOBS_H
+#define LAB2_JOBS_H
+
+#include <poll.h>
+#include <stddef.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+typedef struct {
+  pid_t pid;
+  int pidfd; /* -1 when the kernel has no pidfd_open */
+  void *data; /* caller's per-job context, handed back on completion */
+} job_t;
+
+/* Called once per finished job with its wait status and the resources it
+   used (from wait4). */
+typedef void (*job_done_fn)(const job_t *job, int status,
+                            const struct rusage *usage, void *ctx);
+
+typedef struct {
+  job_t *jobs;
+  struct pollfd *pfds;
+  size_t count;
+  size_t cap;
+  size_t limit;
+  job_done_fn on_done;
+  void *ctx;
+} job_pool_t;
+
+/* At most `limit` jobs run at once. Returns 0, or -1 if allocation fails. */
+int job_pool_init(job_pool_t *pool, size_t limit, job_done_fn on_done,
+                  void *ctx);
+void job_pool_destroy(job_pool_t *pool);
+
+/* Track a started child; call job_pool_wait_slots() first to respect the
+   limit. Returns 0 or -1 with errno set. */
+int job_pool_add(job_pool_t *pool, pid_t pid, void *data);
+
+/* Reap whatever has finished, waiting up to `timeout_ms` (-1: until at
+   least one job ends). Returns the number reaped, or -1 with errno set. */
+int job_pool_reap(job_pool_t *pool, int timeout_ms);
+
+/* Block until `n` more jobs fit under the limit. A pipeline's stages must
+   all run together, so when n exceeds the limit this waits for the pool to
+   empty and then lets the pipeline run over it. */
+int job_pool_wait_slots(job_pool_t *pool, size_t n);
+
+/* Block until every job has finished. */
+int job_pool_drain(job_pool_t *pool);
+
+#endif
@@ -0,0 +1,43 @@
+// Lab 2 - program launch backends (fork+exec, vfork, posix_spawn, zygote)
+#ifndef LAB2_LAUNCH_H
+#define LAB2_LAUNCH_H
+
+#include <sys/types.h>
+
+typedef enum {
+  LAUNCH_FORK = 0, /* fork() + execv(): copies the parent's page tables */
+  LAUNCH_VFORK,    /* vfork() + execv(): child borrows the parent's memory */
+  LAUNCH_SPAWN,    /* posix_spawn() */
+  LAUNCH_ZYGOTE,   /* request to a spawn server forked at startup */
+} launch_mode_t;
+
+typedef enum {
+  LAUNCH_OK = 0,
+  LAUNCH_ERR_FORK = -1, /* no child was created; errno is set */
+  LAUNCH_ERR_EXEC = -2, /* the child could not exec; errno is set */
+} launch_status_t;
+
+/* Where the child's stdin/stdout come from; -1 leaves them inherited.
+   Pass descriptors created with O_CLOEXEC (e.g. pipe2) so the child gets
+   only these two. */
+typedef struct {
+  int in_fd;
+  int out_fd;
+} launch_io_t;
+
+/* "fork", "vfork", "spawn" or "zygote". Returns 0, or -1 for an unknown
+   name. */
+int launch_mode_parse(const char *name, launch_mode_t *mode);
+const char *launch_mode_name(launch_mode_t mode);
+
+/* Start `path` with `argv` (and `io`, which may be NULL) and store the
+   child's pid.
+   With LAUNCH_FORK an exec failure is reported by the child itself
+   (perror("Exec failure"), exit status 1), exactly as before; the other
+   modes see the failure in the parent, reap the child and return
+   LAUNCH_ERR_EXEC so the caller can report it. */
+launch_status_t launch_program(launch_mode_t mode, const char *path,
+                               char *const argv[], const launch_io_t *io,
+                               pid_t *pid);
+
+#endif
@@ -0,0 +1,48 @@
+// Lab 2 - PATH lookup backed by a hash cache of resolved executables
+#ifndef LAB2_PATHCACHE_H
+#define LAB2_PATHCACHE_H
+
+#include <stddef.h>
+#include <time.h>
+
+struct path_entry; /* uthash node, see pathcache.c */
+
+typedef struct {
+  char *dir;
+  int wd;                /* inotify watch, or -1 (missing, or inotify off) */
+  struct timespec mtime; /* compared on every lookup while wd is -1 */
+} path_dir_t;
+
+typedef struct {
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long invalidations;
+} path_cache_stats_t;
+
+typedef struct {
+  struct path_entry *entries;
+  char *path_env; /* copy of $PATH the directory list was built from */
+  path_dir_t *dirs;
+  size_t ndirs;
+  int inotify_fd; /* -1: fall back to comparing directory mtimes */
+  path_cache_stats_t stats;
+} path_cache_t;
+
+/* Returns 0, or -1 with errno set. */
+int path_cache_init(path_cache_t *pc);
+void path_cache_destroy(path_cache_t *pc);
+
+/* Resolve `name` the way execvp would: names containing '/' are used as
+   they are, anything else is searched for in $PATH. Results (including
+   "not found") are cached until a PATH directory changes or $PATH itself
+   does. Returns `name` itself when it has a '/', otherwise a path owned by
+   the cache and valid until the next lookup; NULL with errno = ENOENT if
+   nothing matches. */
+const char *path_cache_lookup(path_cache_t *pc, const char *name);
+
+/* Call after changing the working directory: if $PATH has relative or
+   empty entries, what they resolved to is dropped and they are watched
+   again from the new directory. */
+void path_cache_chdir(path_cache_t *pc);
+
+#endif
@@ -0,0 +1,67 @@
+// Lab 2 - "a | b | c" command lines: parsing, launching, splice relay
+#ifndef LAB2_PIPELINE_H
+#define LAB2_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "launch.h"
+#include "pathcache.h"
+
+/* A parsed command line. Words point into the parsed line; stage i's argv
+   is words + stage[i] and is NULL-terminated. Reused across lines, so
+   steady-state parsing doesn't allocate. */
+typedef struct {
+  char **words;
+  size_t nwords;
+  size_t words_cap;
+  size_t *stage;
+  pid_t *pids; /* per stage after pipeline_start(); -1 if it didn't start */
+  size_t nstages;
+  size_t stages_cap;
+} pipeline_t;
+
+/* One connection between two stages when relaying through the runner. */
+typedef struct {
+  int from; /* read end: the earlier stage's stdout */
+  int to;   /* write end: the later stage's stdin */
+  unsigned long long bytes;
+} relay_link_t;
+
+typedef struct {
+  relay_link_t *links;
+  size_t nlinks;
+  size_t cap;
+} relay_t;
+
+void pipeline_init(pipeline_t *pl);
+void pipeline_free(pipeline_t *pl);
+
+/* Split `line` (modified in place) on '|' and whitespace. A blank line
+   gives 0 stages. Returns 0, or -1 with errno = EINVAL for an empty stage
+   ("a | | b") or ENOMEM. */
+int pipeline_parse(pipeline_t *pl, char *line);
+
+static inline char **pipeline_argv(const pipeline_t *pl, size_t i) {
+  return pl->words + pl->stage[i];
+}
+
+/* Launch every stage with stage i's stdout feeding stage i+1's stdin.
+   With `relay` NULL the stages share a pipe directly; otherwise each link
+   gets two pipes and the runner moves the data between them with splice()
+   (call relay_run() next). A stage that fails to exec is reported
+   ("Exec failure: ...") and gets pid -1; its neighbours see EOF/EPIPE.
+   Returns LAUNCH_ERR_FORK (errno set) if a process or pipe couldn't be
+   created, else LAUNCH_OK. */
+launch_status_t pipeline_start(pipeline_t *pl, launch_mode_t mode,
+                               path_cache_t *paths, relay_t *relay);
+
+void relay_init(relay_t *relay);
+void relay_free(relay_t *relay);
+
+/* Splice every link until each one reaches EOF. The data never enters
+   userspace. Returns 0, or -1 with errno set. */
+int relay_run(relay_t *relay);
+
+#endif
@@ -0,0 +1,47 @@
+// Lab 2 - per-command resource profile collected from wait4()
+#ifndef LAB2_PROFILE_H
+#define LAB2_PROFILE_H
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <time.h>
+
+/* One launched process. `wall` runs from launch until it was reaped and
+   stays negative until then. */
+typedef struct {
+  char *command; /* argv joined with spaces */
+  pid_t pid;
+  struct timespec start;
+  double wall;
+  int status;
+  struct rusage usage;
+} prof_record_t;
+
+typedef struct {
+  prof_record_t *records;
+  size_t count;
+  size_t cap;
+} profile_t;
+
+typedef enum { PROF_TABLE, PROF_JSON } prof_format_t;
+
+void profile_init(profile_t *prof);
+void profile_free(profile_t *prof);
+
+/* Start a record for `pid`, launched at `start`. Returns its index, or -1
+   if allocation fails. */
+long profile_start(profile_t *prof, char *const argv[], pid_t pid,
+                   const struct timespec *start);
+
+/* Complete record `i` with the status and usage wait4() returned. */
+void profile_finish(profile_t *prof, size_t i, int status,
+                    const struct rusage *usage);
+
+/* "table" or "json". Returns 0, or -1 if the name is unknown. */
+int profile_format_parse(const char *name, prof_format_t *format);
+
+/* Write every finished record and wall-time percentiles. */
+void profile_report(const profile_t *prof, prof_format_t format, FILE *out);
+
+#endif
@@ -0,0 +1,30 @@
+// Lab 2 - pre-forked spawn server ("zygote")
+//
+// fork() copies the caller's page tables, so it slows down as the front end
+// grows. The zygote is forked once while the front end is still small and
+// launches programs on request over a Unix socket. It creates each child
+// with clone(CLONE_PARENT), which makes the child a child of the front end:
+// waitpid/wait4/pidfd reaping works exactly as for the other backends.
+#ifndef LAB2_ZYGOTE_H
+#define LAB2_ZYGOTE_H
+
+#include "launch.h"
+
+/* Largest request (path + argv strings) the zygote accepts. */
+#define ZYGOTE_MAX_REQUEST 65536
+
+/* Fork the server now. Call early, before the heap grows; launching in
+   LAUNCH_ZYGOTE mode without it starts one lazily. Returns 0, or -1 with
+   errno set. */
+int zygote_start(void);
+
+/* Shut the server down and reap it. */
+void zygote_stop(void);
+
+/* launch_program() for LAUNCH_ZYGOTE. The child gets the caller's current
+   directory and `io` at launch time; its environment is the one the
+   zygote was started with. Not thread-safe. */
+launch_status_t zygote_launch(const char *path, char *const argv[],
+                              const launch_io_t *io, pid_t *pid);
+
+#endif
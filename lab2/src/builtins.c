@@ -0,0 +1,121 @@
+// Lab 2 - commands that run inside the runner, with no fork/exec
+#define _GNU_SOURCE
+#include "builtins.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int builtin_echo(char **argv, builtin_env_t *env) {
+  (void)env;
+  bool newline = true;
+  size_t i = 1;
+  if (argv[i] != NULL && strcmp(argv[i], "-n") == 0) {
+    newline = false;
+    i++;
+  }
+  for (size_t first = i; argv[i] != NULL; i++) {
+    if (i > first) {
+      putchar(' ');
+    }
+    fputs(argv[i], stdout);
+  }
+  if (newline) {
+    putchar('\n');
+  }
+  // Children write straight to fd 1, so don't let this sit in the buffer.
+  return fflush(stdout) == 0 ? 0 : 1;
+}
+
+static int builtin_cd(char **argv, builtin_env_t *env) {
+  const char *dir = argv[1] != NULL ? argv[1] : getenv("HOME");
+  if (dir == NULL) {
+    fprintf(stderr, "cd: HOME not set\n");
+    return 1;
+  }
+  if (chdir(dir) < 0) {
+    fprintf(stderr, "cd: %s: %s\n", dir, strerror(errno));
+    return 1;
+  }
+  env->cwd_changed = true;
+  return 0;
+}
+
+static int builtin_pwd(char **argv, builtin_env_t *env) {
+  (void)argv;
+  (void)env;
+  char *cwd = getcwd(NULL, 0);
+  if (cwd == NULL) {
+    perror("pwd");
+    return 1;
+  }
+  puts(cwd);
+  free(cwd);
+  return fflush(stdout) == 0 ? 0 : 1;
+}
+
+static int builtin_exit(char **argv, builtin_env_t *env) {
+  int status = 0;
+  if (argv[1] != NULL) {
+    char *end;
+    long n = strtol(argv[1], &end, 10);
+    if (end == argv[1] || *end != '\0') {
+      fprintf(stderr, "exit: %s: numeric argument required\n", argv[1]);
+      n = 2;
+    }
+    status = (int)(n & 0xff);
+  }
+  env->exit_requested = true;
+  env->exit_status = status;
+  return status;
+}
+
+static int builtin_true(char **argv, builtin_env_t *env) {
+  (void)argv;
+  (void)env;
+  return 0;
+}
+
+static int builtin_false(char **argv, builtin_env_t *env) {
+  (void)argv;
+  (void)env;
+  return 1;
+}
+
+static int builtin_sleep(char **argv, builtin_env_t *env) {
+  (void)env;
+  if (argv[1] == NULL) {
+    fprintf(stderr, "sleep: missing operand\n");
+    return 1;
+  }
+  char *end;
+  double secs = strtod(argv[1], &end);
+  if (end == argv[1] || *end != '\0' || secs < 0) {
+    fprintf(stderr, "sleep: invalid time interval '%s'\n", argv[1]);
+    return 1;
+  }
+  struct timespec ts = {.tv_sec = (time_t)secs};
+  ts.tv_nsec = (long)((secs - (double)ts.tv_sec) * 1e9);
+  while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+  }
+  return 0;
+}
+
+static const builtin_t builtins[] = {
+    {"echo", builtin_echo, false}, {"cd", builtin_cd, false},
+    {"pwd", builtin_pwd, false},   {"exit", builtin_exit, false},
+    {"true", builtin_true, false}, {"false", builtin_false, false},
+    {"sleep", builtin_sleep, true},
+};
+
+const builtin_t *builtin_find(const char *name) {
+  for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+    if (strcmp(name, builtins[i].name) == 0) {
+      return &builtins[i];
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,172 @@
+// Lab 2 - bounded pool of background jobs, reaped through pidfds
+#define _GNU_SOURCE
+#include "jobs.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+static int pidfd_open(pid_t pid) {
+  return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+int job_pool_init(job_pool_t *pool, size_t limit, job_done_fn on_done,
+                  void *ctx) {
+  pool->jobs = calloc(limit, sizeof(*pool->jobs));
+  pool->pfds = calloc(limit, sizeof(*pool->pfds));
+  pool->count = 0;
+  pool->cap = limit;
+  pool->limit = limit;
+  pool->on_done = on_done;
+  pool->ctx = ctx;
+  if (pool->jobs == NULL || pool->pfds == NULL) {
+    job_pool_destroy(pool);
+    return -1;
+  }
+  return 0;
+}
+
+void job_pool_destroy(job_pool_t *pool) {
+  for (size_t i = 0; i < pool->count; i++) {
+    if (pool->jobs[i].pidfd >= 0) {
+      close(pool->jobs[i].pidfd);
+    }
+  }
+  free(pool->jobs);
+  free(pool->pfds);
+  pool->jobs = NULL;
+  pool->pfds = NULL;
+  pool->count = 0;
+}
+
+int job_pool_add(job_pool_t *pool, pid_t pid, void *data) {
+  if (pool->count == pool->cap) {
+    size_t cap = pool->cap * 2;
+    job_t *jobs = realloc(pool->jobs, cap * sizeof(*jobs));
+    if (jobs == NULL) {
+      return -1;
+    }
+    pool->jobs = jobs;
+    struct pollfd *pfds = realloc(pool->pfds, cap * sizeof(*pfds));
+    if (pfds == NULL) {
+      return -1;
+    }
+    pool->pfds = pfds;
+    pool->cap = cap;
+  }
+  // A child that already exited is a zombie until reaped, so the pidfd is
+  // still valid and polls readable straight away.
+  int fd = pidfd_open(pid);
+  if (fd < 0 && errno != ENOSYS) {
+    return -1;
+  }
+  size_t i = pool->count++;
+  pool->jobs[i] = (job_t){.pid = pid, .pidfd = fd, .data = data};
+  pool->pfds[i] = (struct pollfd){.fd = fd, .events = POLLIN};
+  return 0;
+}
+
+// Finish job i and move the last job into its slot.
+static int finish(job_pool_t *pool, size_t i) {
+  job_t job = pool->jobs[i];
+  int status;
+  struct rusage usage;
+  pid_t rc;
+  do {
+    rc = wait4(job.pid, &status, 0, &usage);
+  } while (rc < 0 && errno == EINTR);
+  if (rc < 0) {
+    return -1;
+  }
+  if (job.pidfd >= 0) {
+    close(job.pidfd);
+  }
+  pool->count--;
+  pool->jobs[i] = pool->jobs[pool->count];
+  pool->pfds[i] = pool->pfds[pool->count];
+  if (pool->on_done != NULL) {
+    pool->on_done(&job, status, &usage, pool->ctx);
+  }
+  return 0;
+}
+
+// Without pidfds: wait for any of our children directly.
+static int reap_nopidfd(job_pool_t *pool, int timeout_ms) {
+  int reaped = 0;
+  int flags = timeout_ms == 0 ? WNOHANG : 0;
+  while (pool->count > 0) {
+    int status;
+    struct rusage usage;
+    pid_t pid = wait4(-1, &status, reaped > 0 ? WNOHANG : flags, &usage);
+    if (pid < 0 && errno == EINTR) {
+      continue;
+    }
+    if (pid <= 0) {
+      break;
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+      if (pool->jobs[i].pid == pid) {
+        job_t job = pool->jobs[i];
+        pool->jobs[i] = pool->jobs[--pool->count];
+        pool->pfds[i] = pool->pfds[pool->count];
+        if (pool->on_done != NULL) {
+          pool->on_done(&job, status, &usage, pool->ctx);
+        }
+        reaped++;
+        break;
+      }
+    }
+  }
+  return reaped;
+}
+
+int job_pool_reap(job_pool_t *pool, int timeout_ms) {
+  if (pool->count == 0) {
+    return 0;
+  }
+  if (pool->jobs[0].pidfd < 0) {
+    return reap_nopidfd(pool, timeout_ms);
+  }
+
+  int ready = poll(pool->pfds, pool->count, timeout_ms);
+  if (ready < 0) {
+    return errno == EINTR ? 0 : -1;
+  }
+  int reaped = 0;
+  // Walk backwards so finish()'s swap-with-last never skips a ready job.
+  for (size_t i = pool->count; i-- > 0 && ready > 0;) {
+    if (pool->pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+      ready--;
+      if (finish(pool, i) < 0) {
+        return -1;
+      }
+      reaped++;
+    }
+  }
+  return reaped;
+}
+
+int job_pool_wait_slots(job_pool_t *pool, size_t n) {
+  while (pool->count > 0 && pool->count + n > pool->limit) {
+    if (job_pool_reap(pool, -1) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int job_pool_drain(job_pool_t *pool) {
+  while (pool->count > 0) {
+    if (job_pool_reap(pool, -1) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,484 @@
+#define _DEFAULT_SOURCE // wait4
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "builtins.h"
+#include "jobs.h"
+#include "launch.h"
+#include "pathcache.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "zygote.h"
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-m fork|vfork|spawn|zygote] [-j jobs | -r] [-f script] "
+          "[-p table|json [-o report]] [-v]\n",
+          prog);
+  fprintf(stderr, "  -m  launch backend (default: $LAB2_LAUNCH or fork)\n");
+  fprintf(stderr, "  -j  run each program as a background job, at most "
+                  "this many at once\n");
+  fprintf(stderr, "  -f  read programs from this script instead of stdin "
+                  "('#' starts a comment line)\n");
+  fprintf(stderr, "  -r  relay pipeline data through the runner with "
+                  "splice()\n");
+  fprintf(stderr, "  -p  profile every process with wait4() and report "
+                  "on exit\n");
+  fprintf(stderr, "  -o  write the profile here instead of stderr\n");
+  fprintf(stderr, "  -v  print PATH cache and relay statistics\n");
+  fprintf(stderr, "Lines are programs with arguments, optionally joined "
+                  "into pipelines: a x | b | c\n");
+  fprintf(stderr, "Builtins (no fork/exec): echo cd pwd exit true false "
+                  "sleep, and a time prefix\n");
+}
+
+typedef struct {
+  launch_mode_t mode;
+  path_cache_t paths;
+  pipeline_t pipeline;
+  relay_t relay;
+  profile_t prof;
+  builtin_env_t builtins;
+  bool profiling;
+  bool use_relay;
+  bool verbose;
+} runner_t;
+
+// Parse a line into the runner's pipeline. Returns the number of stages,
+// or -1 after reporting a malformed line.
+static int parse_line(runner_t *r, char *line) {
+  if (line[strspn(line, " \t")] == '#') {
+    return 0;
+  }
+  if (pipeline_parse(&r->pipeline, line) < 0) {
+    if (errno == EINVAL) {
+      fprintf(stderr, "syntax error: empty command in pipeline\n");
+    } else {
+      perror("malloc");
+    }
+    return -1;
+  }
+  return (int)r->pipeline.nstages;
+}
+
+// Open a profile record for every stage that started. Returns the index of
+// the first one; stage records follow in order, skipping failed stages.
+static size_t profile_stages(runner_t *r, const struct timespec *start) {
+  size_t first = r->prof.count;
+  if (!r->profiling) {
+    return first;
+  }
+  for (size_t i = 0; i < r->pipeline.nstages; i++) {
+    pid_t pid = r->pipeline.pids[i];
+    if (pid >= 0 && profile_start(&r->prof, pipeline_argv(&r->pipeline, i),
+                                  pid, start) < 0) {
+      perror("malloc");
+    }
+  }
+  return first;
+}
+
+static void profile_reaped(runner_t *r, size_t first, pid_t pid, int status,
+                           const struct rusage *usage) {
+  for (size_t i = first; r->profiling && i < r->prof.count; i++) {
+    if (r->prof.records[i].pid == pid) {
+      profile_finish(&r->prof, i, status, usage);
+      return;
+    }
+  }
+}
+
+// Read one command line; returns false at EOF.
+static bool read_command(FILE *in, char **line, size_t *len) {
+  ssize_t nread = getline(line, len, in);
+  if (nread < 0) {
+    return false;
+  }
+  if (nread > 0 && (*line)[nread - 1] == '\n') {
+    (*line)[nread - 1] = '\0';
+  }
+  return true;
+}
+
+/* ---------- builtins and time ---------- */
+
+// A lone builtin runs in the runner itself. In a pipeline every stage is
+// a process, so "echo" there is /bin/echo as before.
+static const builtin_t *single_builtin(runner_t *r) {
+  if (r->pipeline.nstages != 1) {
+    return NULL;
+  }
+  return builtin_find(pipeline_argv(&r->pipeline, 0)[0]);
+}
+
+// Run a builtin in the runner. A cd leaves relative PATH entries
+// pointing somewhere else, so the cache hears about it.
+static void run_builtin(runner_t *r, const builtin_t *builtin) {
+  builtin->run(pipeline_argv(&r->pipeline, 0), &r->builtins);
+  if (r->builtins.cwd_changed) {
+    r->builtins.cwd_changed = false;
+    path_cache_chdir(&r->paths);
+  }
+}
+
+// Drop a leading "time" word. Returns true if there was one.
+static bool strip_time(runner_t *r) {
+  pipeline_t *pl = &r->pipeline;
+  if (pl->nstages == 0 || strcmp(pipeline_argv(pl, 0)[0], "time") != 0) {
+    return false;
+  }
+  pl->stage[0]++;
+  if (pipeline_argv(pl, 0)[0] == NULL) {
+    pl->nstages = 0; /* "time" alone times nothing, as in sh */
+  }
+  return true;
+}
+
+static double tv_seconds(struct timeval tv) {
+  return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+}
+
+// CPU time of the runner plus every child reaped so far.
+static void cpu_seconds(double *user, double *sys) {
+  struct rusage self, children;
+  getrusage(RUSAGE_SELF, &self);
+  getrusage(RUSAGE_CHILDREN, &children);
+  *user = tv_seconds(self.ru_utime) + tv_seconds(children.ru_utime);
+  *sys = tv_seconds(self.ru_stime) + tv_seconds(children.ru_stime);
+}
+
+static void print_time(const char *label, double secs) {
+  fprintf(stderr, "%s\t%dm%.3fs\n", label, (int)(secs / 60),
+          secs - 60.0 * (int)(secs / 60));
+}
+
+/* ---------- one program at a time ---------- */
+
+// Run the parsed line to completion. Returns 0, or -1 after reporting an
+// error the runner can't continue from.
+static int run_foreground(runner_t *r) {
+  int status;
+  struct rusage usage;
+  struct timespec start;
+
+  const builtin_t *builtin = single_builtin(r);
+  if (builtin != NULL) {
+    run_builtin(r, builtin);
+    return 0;
+  }
+  if (r->pipeline.nstages == 0) {
+    return 0;
+  }
+
+  relay_t *relay = r->use_relay ? &r->relay : NULL;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  launch_status_t rc = pipeline_start(&r->pipeline, r->mode, &r->paths, relay);
+  size_t first = profile_stages(r, &start);
+  if (rc == LAUNCH_ERR_FORK) {
+    perror("fork");
+    return -1;
+  }
+  if (relay != NULL) {
+    if (relay_run(relay) < 0) {
+      perror("splice");
+    }
+    if (r->verbose) {
+      for (size_t i = 0; i < relay->nlinks; i++) {
+        fprintf(stderr, "relay %zu: %llu bytes\n", i, relay->links[i].bytes);
+      }
+    }
+    relay_free(relay);
+  }
+
+  // Reap stages in the order they finish so each wall time is exact.
+  size_t running = 0;
+  for (size_t i = 0; i < r->pipeline.nstages; i++) {
+    running += r->pipeline.pids[i] >= 0;
+  }
+  while (running > 0) {
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid < 0 && errno == EINTR) {
+      continue;
+    }
+    if (pid < 0) {
+      perror("wait4");
+      return -1;
+    }
+    for (size_t i = 0; i < r->pipeline.nstages; i++) {
+      if (r->pipeline.pids[i] == pid) {
+        profile_reaped(r, first, pid, status, &usage);
+        running--;
+        break;
+      }
+    }
+  }
+  return 0;
+}
+
+static int run_interactive(FILE *in, runner_t *r) {
+  char *line = NULL;
+  size_t len = 0;
+  int result = EXIT_SUCCESS;
+
+  puts("Enter programs to run.");
+
+  while (!r->builtins.exit_requested) {
+    fputs("> ", stdout);
+    fflush(stdout);
+
+    if (!read_command(in, &line, &len)) {
+      break;
+    }
+    if (parse_line(r, line) <= 0) {
+      puts("Enter programs to run.");
+      continue;
+    }
+
+    bool timed = strip_time(r);
+    struct timespec t0, t1;
+    double user0 = 0, sys0 = 0, user1, sys1;
+    if (timed) {
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      cpu_seconds(&user0, &sys0);
+    }
+    if (run_foreground(r) < 0) {
+      result = EXIT_FAILURE;
+      break;
+    }
+    if (timed) {
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      cpu_seconds(&user1, &sys1);
+      print_time("\nreal", (double)(t1.tv_sec - t0.tv_sec) +
+                               (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+      print_time("user", user1 - user0);
+      print_time("sys", sys1 - sys0);
+    }
+    if (!r->builtins.exit_requested) {
+      puts("Enter programs to run.");
+    }
+  }
+  free(line);
+  if (r->builtins.exit_requested) {
+    result = r->builtins.exit_status;
+  }
+  return result;
+}
+
+/* ---------- background jobs ---------- */
+
+static void report_job(const job_t *job, int status,
+                       const struct rusage *usage, void *ctx) {
+  runner_t *r = ctx;
+  if (job->data != NULL) {
+    profile_finish(&r->prof, (uintptr_t)job->data - 1, status, usage);
+  }
+  if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "[%d] exited with status %d\n", (int)job->pid,
+            WEXITSTATUS(status));
+  } else if (WIFSIGNALED(status) && WTERMSIG(status) != SIGPIPE) {
+    // SIGPIPE is how an upstream stage learns its reader is done.
+    fprintf(stderr, "[%d] killed by signal %d\n", (int)job->pid,
+            WTERMSIG(status));
+  }
+}
+
+static int run_jobs(FILE *in, runner_t *r, size_t limit) {
+  char *line = NULL;
+  size_t len = 0;
+  job_pool_t pool;
+  int result = EXIT_FAILURE;
+
+  if (job_pool_init(&pool, limit, report_job, r) < 0) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  while (read_command(in, &line, &len)) {
+    int nstages = parse_line(r, line);
+    if (nstages <= 0) {
+      continue;
+    }
+    if (strip_time(r)) {
+      fprintf(stderr, "time: not available for background jobs; "
+                      "profile them with -p\n");
+      continue;
+    }
+    // Quick builtins run inline between launches; sleep would stall the
+    // pool, so it goes to /bin/sleep like any other program.
+    const builtin_t *builtin = single_builtin(r);
+    if (builtin != NULL && !builtin->blocks) {
+      run_builtin(r, builtin);
+      if (r->builtins.exit_requested) {
+        break;
+      }
+      continue;
+    }
+    if (job_pool_wait_slots(&pool, (size_t)nstages) < 0) {
+      perror("poll");
+      goto done;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    launch_status_t rc =
+        pipeline_start(&r->pipeline, r->mode, &r->paths, NULL);
+    size_t first = profile_stages(r, &start);
+    for (size_t i = 0; i < r->pipeline.nstages; i++) {
+      pid_t pid = r->pipeline.pids[i];
+      if (pid < 0) {
+        continue;
+      }
+      // Tag the job with its profile record, offset by one so NULL means
+      // "not profiled".
+      void *data = NULL;
+      if (first < r->prof.count && r->prof.records[first].pid == pid) {
+        data = (void *)(uintptr_t)(++first);
+      }
+      if (job_pool_add(&pool, pid, data) < 0) {
+        perror("pidfd_open");
+        goto done;
+      }
+    }
+    if (rc == LAUNCH_ERR_FORK) {
+      perror("fork");
+      goto done;
+    }
+    // Pick up anything that already finished without blocking.
+    if (job_pool_reap(&pool, 0) < 0) {
+      perror("poll");
+      goto done;
+    }
+  }
+
+  if (job_pool_drain(&pool) < 0) {
+    perror("poll");
+    goto done;
+  }
+  result = r->builtins.exit_requested ? r->builtins.exit_status
+                                      : EXIT_SUCCESS;
+
+done:
+  job_pool_destroy(&pool);
+  free(line);
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  runner_t r = {.mode = LAUNCH_FORK};
+  const char *mode_name = getenv("LAB2_LAUNCH");
+  const char *batch = NULL;
+  const char *report = NULL;
+  prof_format_t format = PROF_TABLE;
+  long jobs = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "m:j:f:p:o:rv")) != -1) {
+    switch (opt) {
+    case 'm':
+      mode_name = optarg;
+      break;
+    case 'j':
+      jobs = strtol(optarg, NULL, 10);
+      if (jobs < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'f':
+      batch = optarg;
+      break;
+    case 'p':
+      if (profile_format_parse(optarg, &format) < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      r.profiling = true;
+      break;
+    case 'o':
+      report = optarg;
+      break;
+    case 'r':
+      r.use_relay = true;
+      break;
+    case 'v':
+      r.verbose = true;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (mode_name != NULL && launch_mode_parse(mode_name, &r.mode) < 0) {
+    fprintf(stderr, "unknown launch backend: %s\n", mode_name);
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (r.use_relay && jobs > 0) {
+    fprintf(stderr, "-r relays in the foreground and can't be combined "
+                    "with -j\n");
+    return EXIT_FAILURE;
+  }
+
+  // Fork the spawn server before anything else is allocated.
+  if (r.mode == LAUNCH_ZYGOTE && zygote_start() < 0) {
+    perror("zygote");
+    return EXIT_FAILURE;
+  }
+
+  FILE *in = stdin;
+  if (batch != NULL) {
+    in = fopen(batch, "r");
+    if (in == NULL) {
+      perror(batch);
+      return EXIT_FAILURE;
+    }
+  }
+
+  FILE *report_out = stderr;
+  if (report != NULL) {
+    report_out = fopen(report, "w");
+    if (report_out == NULL) {
+      perror(report);
+      return EXIT_FAILURE;
+    }
+  }
+
+  path_cache_init(&r.paths);
+  pipeline_init(&r.pipeline);
+  relay_init(&r.relay);
+  profile_init(&r.prof);
+
+  int result = jobs > 0 ? run_jobs(in, &r, (size_t)jobs)
+                        : run_interactive(in, &r);
+  if (r.verbose) {
+    fprintf(stderr, "path cache: %lu hits, %lu misses, %lu invalidations\n",
+            r.paths.stats.hits, r.paths.stats.misses,
+            r.paths.stats.invalidations);
+  }
+  if (r.profiling) {
+    profile_report(&r.prof, format, report_out);
+  }
+  if (report_out != stderr) {
+    fclose(report_out);
+  }
+  profile_free(&r.prof);
+  relay_free(&r.relay);
+  pipeline_free(&r.pipeline);
+  path_cache_destroy(&r.paths);
+  zygote_stop();
+  if (in != stdin) {
+    fclose(in);
+  }
+  return result;
+}
@@ -0,0 +1,134 @@
+// Lab 2 - program launch backends (fork+exec, vfork, posix_spawn, zygote)
+#define _DEFAULT_SOURCE
+#include "launch.h"
+#include "zygote.h"
+
+#include <errno.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static const char *const mode_names[] = {
+    [LAUNCH_FORK] = "fork",
+    [LAUNCH_VFORK] = "vfork",
+    [LAUNCH_SPAWN] = "spawn",
+    [LAUNCH_ZYGOTE] = "zygote",
+};
+
+int launch_mode_parse(const char *name, launch_mode_t *mode) {
+  for (size_t i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++) {
+    if (strcmp(name, mode_names[i]) == 0) {
+      *mode = (launch_mode_t)i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *launch_mode_name(launch_mode_t mode) { return mode_names[mode]; }
+
+/* ---------- backends ---------- */
+
+// Only async-signal-safe calls: this also runs in the vfork child.
+static void apply_io(const launch_io_t *io) {
+  if (io == NULL) {
+    return;
+  }
+  if (io->in_fd >= 0 && io->in_fd != STDIN_FILENO) {
+    dup2(io->in_fd, STDIN_FILENO);
+  }
+  if (io->out_fd >= 0 && io->out_fd != STDOUT_FILENO) {
+    dup2(io->out_fd, STDOUT_FILENO);
+  }
+}
+
+static launch_status_t launch_fork(const char *path, char *const argv[],
+                                   const launch_io_t *io, pid_t *pid) {
+  pid_t child = fork();
+  if (child < 0) {
+    return LAUNCH_ERR_FORK;
+  }
+  if (child == 0) {
+    apply_io(io);
+    execv(path, argv);
+    perror("Exec failure");
+    _exit(EXIT_FAILURE);
+  }
+  *pid = child;
+  return LAUNCH_OK;
+}
+
+// The vfork child runs on the parent's memory until it execs or exits, so
+// it can hand its errno back through a plain variable.
+static launch_status_t launch_vfork(const char *path, char *const argv[],
+                                    const launch_io_t *io, pid_t *pid) {
+  volatile int exec_errno = 0;
+  pid_t child = vfork();
+  if (child < 0) {
+    return LAUNCH_ERR_FORK;
+  }
+  if (child == 0) {
+    apply_io(io);
+    execv(path, argv);
+    exec_errno = errno;
+    _exit(127);
+  }
+  if (exec_errno != 0) {
+    (void)waitpid(child, NULL, 0);
+    errno = exec_errno;
+    return LAUNCH_ERR_EXEC;
+  }
+  *pid = child;
+  return LAUNCH_OK;
+}
+
+static launch_status_t launch_spawn(const char *path, char *const argv[],
+                                    const launch_io_t *io, pid_t *pid) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_t *actionsp = NULL;
+  int rc;
+
+  if (io != NULL && (io->in_fd >= 0 || io->out_fd >= 0)) {
+    actionsp = &actions;
+    posix_spawn_file_actions_init(actionsp);
+    if (io->in_fd >= 0 && io->in_fd != STDIN_FILENO) {
+      posix_spawn_file_actions_adddup2(actionsp, io->in_fd, STDIN_FILENO);
+    }
+    if (io->out_fd >= 0 && io->out_fd != STDOUT_FILENO) {
+      posix_spawn_file_actions_adddup2(actionsp, io->out_fd, STDOUT_FILENO);
+    }
+  }
+
+  // glibc's posix_spawn uses CLONE_VFORK and returns the exec error (having
+  // already reaped the child); failures to create the child come back the
+  // same way, so tell them apart by errno.
+  rc = posix_spawn(pid, path, actionsp, NULL, argv, environ);
+  if (actionsp != NULL) {
+    posix_spawn_file_actions_destroy(actionsp);
+  }
+  if (rc != 0) {
+    errno = rc;
+    return (rc == EAGAIN || rc == ENOMEM) ? LAUNCH_ERR_FORK : LAUNCH_ERR_EXEC;
+  }
+  return LAUNCH_OK;
+}
+
+launch_status_t launch_program(launch_mode_t mode, const char *path,
+                               char *const argv[], const launch_io_t *io,
+                               pid_t *pid) {
+  switch (mode) {
+  case LAUNCH_VFORK:
+    return launch_vfork(path, argv, io, pid);
+  case LAUNCH_SPAWN:
+    return launch_spawn(path, argv, io, pid);
+  case LAUNCH_ZYGOTE:
+    return zygote_launch(path, argv, io, pid);
+  default:
+    return launch_fork(path, argv, io, pid);
+  }
+}
@@ -0,0 +1,246 @@
+// Lab 2 - PATH lookup backed by a hash cache of resolved executables
+#define _GNU_SOURCE
+#include "pathcache.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <uthash.h>
+
+#define DEFAULT_PATH "/usr/local/bin:/usr/bin:/bin"
+
+// Events on a PATH directory that can change what a name resolves to.
+#define WATCH_MASK                                                             \
+  (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |           \
+   IN_DELETE_SELF | IN_MOVE_SELF)
+
+struct path_entry {
+  char *name;     /* key */
+  char *resolved; /* NULL: not found anywhere in PATH */
+  UT_hash_handle hh;
+};
+
+/* ---------- cache contents ---------- */
+
+static void clear_entries(path_cache_t *pc) {
+  struct path_entry *entry, *tmp;
+  HASH_ITER(hh, pc->entries, entry, tmp) {
+    HASH_DEL(pc->entries, entry);
+    free(entry->name);
+    free(entry->resolved);
+    free(entry);
+  }
+}
+
+static void invalidate(path_cache_t *pc) {
+  if (pc->entries != NULL) {
+    pc->stats.invalidations++;
+  }
+  clear_entries(pc);
+}
+
+/* ---------- PATH directories ---------- */
+
+static void free_dirs(path_cache_t *pc) {
+  for (size_t i = 0; i < pc->ndirs; i++) {
+    free(pc->dirs[i].dir);
+  }
+  free(pc->dirs);
+  free(pc->path_env);
+  pc->dirs = NULL;
+  pc->ndirs = 0;
+  pc->path_env = NULL;
+  if (pc->inotify_fd >= 0) {
+    close(pc->inotify_fd); /* drops every watch */
+    pc->inotify_fd = -1;
+  }
+}
+
+static struct timespec dir_mtime(const char *dir) {
+  struct stat st;
+  if (stat(dir, &st) < 0) {
+    return (struct timespec){0, 0};
+  }
+  return st.st_mtim;
+}
+
+// Split `path_env` into directories and watch each one.
+static int load_dirs(path_cache_t *pc, const char *path_env) {
+  pc->path_env = strdup(path_env);
+  if (pc->path_env == NULL) {
+    return -1;
+  }
+  size_t n = 1;
+  for (const char *c = path_env; *c; c++) {
+    n += *c == ':';
+  }
+  pc->dirs = calloc(n, sizeof(*pc->dirs));
+  if (pc->dirs == NULL) {
+    return -1;
+  }
+
+  pc->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  const char *start = path_env;
+  for (size_t i = 0; i < n; i++) {
+    const char *end = strchr(start, ':');
+    size_t len = end ? (size_t)(end - start) : strlen(start);
+    // An empty entry means the current directory.
+    pc->dirs[i].dir = len ? strndup(start, len) : strdup(".");
+    if (pc->dirs[i].dir == NULL) {
+      return -1;
+    }
+    pc->ndirs++;
+    pc->dirs[i].mtime = dir_mtime(pc->dirs[i].dir);
+    pc->dirs[i].wd = -1;
+    if (pc->inotify_fd >= 0) {
+      // A directory that can't be watched (e.g. missing) still matters: a
+      // cached "not found" holds only until the directory appears with the
+      // program in it. check_fresh() compares its mtime instead.
+      pc->dirs[i].wd =
+          inotify_add_watch(pc->inotify_fd, pc->dirs[i].dir, WATCH_MASK);
+    }
+    start = end ? end + 1 : start + len;
+  }
+  return 0;
+}
+
+// A watch was removed (its directory deleted or moved): from now on the
+// directory is checked by mtime, starting from "missing".
+static void forget_watch(path_cache_t *pc, int wd) {
+  for (size_t i = 0; i < pc->ndirs; i++) {
+    if (pc->dirs[i].wd == wd) {
+      pc->dirs[i].wd = -1;
+      pc->dirs[i].mtime = (struct timespec){0, 0};
+    }
+  }
+}
+
+// Drop the cache if $PATH was changed or a directory in it was modified.
+static int check_fresh(path_cache_t *pc) {
+  const char *path_env = getenv("PATH");
+  if (path_env == NULL) {
+    path_env = DEFAULT_PATH;
+  }
+  if (pc->path_env == NULL || strcmp(path_env, pc->path_env) != 0) {
+    invalidate(pc);
+    free_dirs(pc);
+    return load_dirs(pc, path_env);
+  }
+
+  bool changed = false;
+  if (pc->inotify_fd >= 0) {
+    // Non-blocking reads; EAGAIN (nothing changed) is the common case.
+    char events[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(pc->inotify_fd, events, sizeof(events))) > 0) {
+      changed = true;
+      for (char *p = events; p < events + n;) {
+        const struct inotify_event *ev = (const struct inotify_event *)p;
+        if (ev->mask & IN_MOVE_SELF) {
+          // The watch would follow the directory to its new name
+          inotify_rm_watch(pc->inotify_fd, ev->wd);
+        }
+        if (ev->mask & (IN_IGNORED | IN_MOVE_SELF)) {
+          forget_watch(pc, ev->wd); // the directory went away
+        }
+        p += sizeof(*ev) + ev->len;
+      }
+    }
+  }
+
+  // Directories without a watch: a changed mtime (a missing one that now
+  // exists has one) drops the cache, and inotify gets another try.
+  for (size_t i = 0; i < pc->ndirs; i++) {
+    path_dir_t *d = &pc->dirs[i];
+    if (d->wd >= 0) {
+      continue;
+    }
+    struct timespec m = dir_mtime(d->dir);
+    if (m.tv_sec != d->mtime.tv_sec || m.tv_nsec != d->mtime.tv_nsec) {
+      d->mtime = m;
+      changed = true;
+      if (pc->inotify_fd >= 0) {
+        d->wd = inotify_add_watch(pc->inotify_fd, d->dir, WATCH_MASK);
+      }
+    }
+  }
+  if (changed) {
+    invalidate(pc);
+  }
+  return 0;
+}
+
+static char *search_path(const path_cache_t *pc, const char *name) {
+  for (size_t i = 0; i < pc->ndirs; i++) {
+    char *candidate;
+    if (asprintf(&candidate, "%s/%s", pc->dirs[i].dir, name) < 0) {
+      return NULL;
+    }
+    struct stat st;
+    if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) &&
+        access(candidate, X_OK) == 0) {
+      return candidate;
+    }
+    free(candidate);
+  }
+  return NULL;
+}
+
+/* ---------- public API ---------- */
+
+int path_cache_init(path_cache_t *pc) {
+  memset(pc, 0, sizeof(*pc));
+  pc->inotify_fd = -1;
+  return 0;
+}
+
+void path_cache_destroy(path_cache_t *pc) {
+  clear_entries(pc);
+  free_dirs(pc);
+}
+
+const char *path_cache_lookup(path_cache_t *pc, const char *name) {
+  if (strchr(name, '/') != NULL) {
+    return name;
+  }
+  if (check_fresh(pc) < 0) {
+    return NULL;
+  }
+
+  struct path_entry *entry;
+  HASH_FIND_STR(pc->entries, name, entry);
+  if (entry != NULL) {
+    pc->stats.hits++;
+  } else {
+    pc->stats.misses++;
+    entry = calloc(1, sizeof(*entry));
+    if (entry == NULL || (entry->name = strdup(name)) == NULL) {
+      free(entry);
+      return NULL;
+    }
+    entry->resolved = search_path(pc, name);
+    HASH_ADD_KEYPTR(hh, pc->entries, entry->name, strlen(entry->name), entry);
+  }
+
+  if (entry->resolved == NULL) {
+    errno = ENOENT;
+  }
+  return entry->resolved;
+}
+
+void path_cache_chdir(path_cache_t *pc) {
+  for (size_t i = 0; i < pc->ndirs; i++) {
+    if (pc->dirs[i].dir[0] != '/') {
+      // Reloaded by the next lookup, relative to the new directory
+      invalidate(pc);
+      free_dirs(pc);
+      return;
+    }
+  }
+}
@@ -0,0 +1,323 @@
+// Lab 2 - "a | b | c" command lines: parsing, launching, splice relay
+#define _GNU_SOURCE
+#include "pipeline.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define RELAY_CHUNK (1 << 16)
+
+/* ---------- parsing ---------- */
+
+void pipeline_init(pipeline_t *pl) {
+  pl->words = NULL;
+  pl->nwords = 0;
+  pl->words_cap = 0;
+  pl->stage = NULL;
+  pl->pids = NULL;
+  pl->nstages = 0;
+  pl->stages_cap = 0;
+}
+
+void pipeline_free(pipeline_t *pl) {
+  free(pl->words);
+  free(pl->stage);
+  free(pl->pids);
+  pipeline_init(pl);
+}
+
+static int push_word(pipeline_t *pl, char *word) {
+  if (pl->nwords == pl->words_cap) {
+    size_t cap = pl->words_cap ? pl->words_cap * 2 : 16;
+    char **words = realloc(pl->words, cap * sizeof(*words));
+    if (words == NULL) {
+      return -1;
+    }
+    pl->words = words;
+    pl->words_cap = cap;
+  }
+  pl->words[pl->nwords++] = word;
+  return 0;
+}
+
+// Terminate the current stage's argv and record where it starts.
+static int close_stage(pipeline_t *pl, size_t nwords_in_stage) {
+  if (nwords_in_stage == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (push_word(pl, NULL) < 0) {
+    return -1;
+  }
+  if (pl->nstages == pl->stages_cap) {
+    size_t cap = pl->stages_cap ? pl->stages_cap * 2 : 4;
+    size_t *stage = realloc(pl->stage, cap * sizeof(*stage));
+    if (stage == NULL) {
+      return -1;
+    }
+    pl->stage = stage;
+    pid_t *pids = realloc(pl->pids, cap * sizeof(*pids));
+    if (pids == NULL) {
+      return -1;
+    }
+    pl->pids = pids;
+    pl->stages_cap = cap;
+  }
+  pl->pids[pl->nstages] = -1;
+  pl->stage[pl->nstages++] = pl->nwords - nwords_in_stage - 1;
+  return 0;
+}
+
+static int is_blank(char c) { return c == ' ' || c == '\t' || c == '\n'; }
+
+int pipeline_parse(pipeline_t *pl, char *line) {
+  size_t in_stage = 0;
+  char *p = line;
+  pl->nwords = 0;
+  pl->nstages = 0;
+
+  for (;;) {
+    while (is_blank(*p)) {
+      p++;
+    }
+    if (*p == '\0') {
+      if (in_stage == 0 && pl->nstages == 0) {
+        return 0; /* blank line */
+      }
+      return close_stage(pl, in_stage);
+    }
+    if (*p == '|') {
+      if (close_stage(pl, in_stage) < 0) {
+        return -1;
+      }
+      in_stage = 0;
+      p++;
+      continue;
+    }
+
+    char *word = p;
+    while (*p != '\0' && *p != '|' && !is_blank(*p)) {
+      p++;
+    }
+    if (push_word(pl, word) < 0) {
+      return -1;
+    }
+    in_stage++;
+    if (*p == '|') {
+      *p++ = '\0';
+      if (close_stage(pl, in_stage) < 0) {
+        return -1;
+      }
+      in_stage = 0;
+    } else if (*p != '\0') {
+      *p++ = '\0';
+    }
+  }
+}
+
+/* ---------- launching ---------- */
+
+void relay_init(relay_t *relay) {
+  relay->links = NULL;
+  relay->nlinks = 0;
+  relay->cap = 0;
+}
+
+void relay_free(relay_t *relay) {
+  for (size_t i = 0; i < relay->nlinks; i++) {
+    if (relay->links[i].from >= 0) {
+      close(relay->links[i].from);
+    }
+    if (relay->links[i].to >= 0) {
+      close(relay->links[i].to);
+    }
+  }
+  free(relay->links);
+  relay_init(relay);
+}
+
+static int add_link(relay_t *relay, int from, int to) {
+  if (relay->nlinks == relay->cap) {
+    size_t cap = relay->cap ? relay->cap * 2 : 4;
+    relay_link_t *links = realloc(relay->links, cap * sizeof(*links));
+    if (links == NULL) {
+      return -1;
+    }
+    relay->links = links;
+    relay->cap = cap;
+  }
+  relay->links[relay->nlinks++] = (relay_link_t){.from = from, .to = to};
+  // The runner's ends are non-blocking so one slow link can't stall the
+  // others; the children's ends stay blocking.
+  fcntl(from, F_SETFL, fcntl(from, F_GETFL) | O_NONBLOCK);
+  fcntl(to, F_SETFL, fcntl(to, F_GETFL) | O_NONBLOCK);
+  return 0;
+}
+
+static void close_fd(int *fd) {
+  if (*fd >= 0) {
+    close(*fd);
+    *fd = -1;
+  }
+}
+
+// Open the pipe(s) joining a stage to the next one. Every fd is O_CLOEXEC:
+// children receive exactly the two that launch_io_t dup2s into place.
+static int open_link(relay_t *relay, int *out_fd, int *next_in) {
+  int p[2];
+  if (pipe2(p, O_CLOEXEC) < 0) {
+    return -1;
+  }
+  if (relay == NULL) {
+    *out_fd = p[1];
+    *next_in = p[0];
+    return 0;
+  }
+  int q[2];
+  if (pipe2(q, O_CLOEXEC) < 0) {
+    close(p[0]);
+    close(p[1]);
+    return -1;
+  }
+  if (add_link(relay, p[0], q[1]) < 0) {
+    close(p[0]);
+    close(p[1]);
+    close(q[0]);
+    close(q[1]);
+    return -1;
+  }
+  *out_fd = p[1];
+  *next_in = q[0];
+  return 0;
+}
+
+launch_status_t pipeline_start(pipeline_t *pl, launch_mode_t mode,
+                               path_cache_t *paths, relay_t *relay) {
+  int in_fd = -1;
+  for (size_t i = 0; i < pl->nstages; i++) {
+    int out_fd = -1, next_in = -1;
+    if (i + 1 < pl->nstages && open_link(relay, &out_fd, &next_in) < 0) {
+      close_fd(&in_fd);
+      return LAUNCH_ERR_FORK;
+    }
+
+    char **argv = pipeline_argv(pl, i);
+    const char *path = path_cache_lookup(paths, argv[0]);
+    launch_io_t io = {.in_fd = in_fd, .out_fd = out_fd};
+    launch_status_t rc =
+        path ? launch_program(mode, path, argv, &io, &pl->pids[i])
+             : LAUNCH_ERR_EXEC;
+    if (rc != LAUNCH_OK) {
+      pl->pids[i] = -1;
+    }
+    if (rc == LAUNCH_ERR_EXEC) {
+      perror("Exec failure");
+    }
+
+    // The child holds its own copies now.
+    close_fd(&in_fd);
+    close_fd(&out_fd);
+    in_fd = next_in;
+    if (rc == LAUNCH_ERR_FORK) {
+      int err = errno;
+      close_fd(&in_fd);
+      errno = err;
+      return LAUNCH_ERR_FORK;
+    }
+  }
+  return LAUNCH_OK;
+}
+
+/* ---------- splice relay ---------- */
+
+// Move one chunk on link `l`. Returns 1 while the link stays open, 0 when it
+// is finished (EOF upstream or no reader downstream), -1 on error.
+// *blocked says which end we were woken for: `to` (1) or `from` (0).
+static int relay_step(relay_link_t *l, int *blocked) {
+  ssize_t n = splice(l->from, NULL, l->to, NULL, RELAY_CHUNK,
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n > 0) {
+    l->bytes += (unsigned long long)n;
+    *blocked = 0;
+    return 1;
+  }
+  if (n < 0 && errno == EINTR) {
+    return 1;
+  }
+  if (n < 0 && errno == EAGAIN) {
+    // Woken by input, so `to` is full; woken by space, so `from` is empty.
+    *blocked = !*blocked;
+    return 1;
+  }
+  if (n < 0 && errno != EPIPE) {
+    return -1;
+  }
+  // EOF, or the next stage is gone: closing `from` passes EPIPE upstream.
+  close_fd(&l->from);
+  close_fd(&l->to);
+  return 0;
+}
+
+int relay_run(relay_t *relay) {
+  struct pollfd pfds[relay->nlinks > 0 ? relay->nlinks : 1];
+  int blocked[relay->nlinks > 0 ? relay->nlinks : 1];
+  size_t open_links = 0;
+  int rc = 0;
+
+  // A vanished reader must show up as EPIPE here, not kill the runner.
+  // Blocking (rather than ignoring) SIGPIPE keeps the children, which are
+  // already running, unaffected.
+  sigset_t pipe_set, old_set;
+  sigemptyset(&pipe_set);
+  sigaddset(&pipe_set, SIGPIPE);
+  sigprocmask(SIG_BLOCK, &pipe_set, &old_set);
+
+  for (size_t i = 0; i < relay->nlinks; i++) {
+    blocked[i] = 0;
+    open_links += relay->links[i].from >= 0;
+  }
+
+  while (open_links > 0) {
+    for (size_t i = 0; i < relay->nlinks; i++) {
+      relay_link_t *l = &relay->links[i];
+      pfds[i].fd = l->from < 0 ? -1 : blocked[i] ? l->to : l->from;
+      pfds[i].events = blocked[i] ? POLLOUT : POLLIN;
+      pfds[i].revents = 0;
+    }
+    if (poll(pfds, relay->nlinks, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      rc = -1;
+      break;
+    }
+    for (size_t i = 0; i < relay->nlinks; i++) {
+      if (pfds[i].revents == 0) {
+        continue;
+      }
+      int step = relay_step(&relay->links[i], &blocked[i]);
+      if (step < 0) {
+        rc = -1;
+        break;
+      }
+      open_links -= step == 0;
+    }
+    if (rc < 0) {
+      break;
+    }
+  }
+
+  int err = errno;
+  struct timespec zero = {0, 0};
+  while (sigtimedwait(&pipe_set, NULL, &zero) > 0) {
+    /* discard SIGPIPEs raised while relaying */
+  }
+  sigprocmask(SIG_SETMASK, &old_set, NULL);
+  errno = err;
+  return rc;
+}
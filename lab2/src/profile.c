@@ -0,0 +1,231 @@
+// Lab 2 - per-command resource profile collected from wait4()
+#define _GNU_SOURCE
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+void profile_init(profile_t *prof) {
+  prof->records = NULL;
+  prof->count = 0;
+  prof->cap = 0;
+}
+
+void profile_free(profile_t *prof) {
+  for (size_t i = 0; i < prof->count; i++) {
+    free(prof->records[i].command);
+  }
+  free(prof->records);
+  profile_init(prof);
+}
+
+static char *join_argv(char *const argv[]) {
+  size_t len = 1;
+  for (size_t i = 0; argv[i] != NULL; i++) {
+    len += strlen(argv[i]) + 1;
+  }
+  char *s = malloc(len);
+  if (s == NULL) {
+    return NULL;
+  }
+  char *p = s;
+  for (size_t i = 0; argv[i] != NULL; i++) {
+    if (i > 0) {
+      *p++ = ' ';
+    }
+    size_t n = strlen(argv[i]);
+    memcpy(p, argv[i], n);
+    p += n;
+  }
+  *p = '\0';
+  return s;
+}
+
+long profile_start(profile_t *prof, char *const argv[], pid_t pid,
+                   const struct timespec *start) {
+  if (prof->count == prof->cap) {
+    size_t cap = prof->cap ? prof->cap * 2 : 64;
+    prof_record_t *records = realloc(prof->records, cap * sizeof(*records));
+    if (records == NULL) {
+      return -1;
+    }
+    prof->records = records;
+    prof->cap = cap;
+  }
+  char *command = join_argv(argv);
+  if (command == NULL) {
+    return -1;
+  }
+  prof->records[prof->count] = (prof_record_t){
+      .command = command, .pid = pid, .start = *start, .wall = -1};
+  return (long)prof->count++;
+}
+
+void profile_finish(profile_t *prof, size_t i, int status,
+                    const struct rusage *usage) {
+  prof_record_t *rec = &prof->records[i];
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  rec->wall = (double)(now.tv_sec - rec->start.tv_sec) +
+              (double)(now.tv_nsec - rec->start.tv_nsec) * 1e-9;
+  rec->status = status;
+  rec->usage = *usage;
+}
+
+int profile_format_parse(const char *name, prof_format_t *format) {
+  if (strcmp(name, "table") == 0) {
+    *format = PROF_TABLE;
+  } else if (strcmp(name, "json") == 0) {
+    *format = PROF_JSON;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/* ---------- report ---------- */
+
+static double tv_ms(struct timeval tv) {
+  return (double)tv.tv_sec * 1e3 + (double)tv.tv_usec * 1e-3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted[0, n), n > 0.
+static double percentile(const double *sorted, size_t n, size_t p) {
+  size_t rank = (p * n + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+typedef struct {
+  size_t n;
+  double mean, p50, p90, p99, max;
+} wall_stats_t;
+
+static int wall_stats(const profile_t *prof, wall_stats_t *st) {
+  double *walls = malloc((prof->count ? prof->count : 1) * sizeof(*walls));
+  if (walls == NULL) {
+    return -1;
+  }
+  double sum = 0;
+  st->n = 0;
+  for (size_t i = 0; i < prof->count; i++) {
+    if (prof->records[i].wall >= 0) {
+      walls[st->n++] = prof->records[i].wall * 1e3;
+      sum += prof->records[i].wall * 1e3;
+    }
+  }
+  if (st->n > 0) {
+    qsort(walls, st->n, sizeof(*walls), cmp_double);
+    st->mean = sum / (double)st->n;
+    st->p50 = percentile(walls, st->n, 50);
+    st->p90 = percentile(walls, st->n, 90);
+    st->p99 = percentile(walls, st->n, 99);
+    st->max = walls[st->n - 1];
+  }
+  free(walls);
+  return 0;
+}
+
+static void report_table(const profile_t *prof, const wall_stats_t *st,
+                         FILE *out) {
+  fprintf(out, "%8s %-10s %10s %10s %10s %10s %8s %8s %8s %8s  %s\n", "pid",
+          "status", "wall_ms", "user_ms", "sys_ms", "maxrss_kb", "minflt",
+          "majflt", "nvcsw", "nivcsw", "command");
+  for (size_t i = 0; i < prof->count; i++) {
+    const prof_record_t *r = &prof->records[i];
+    if (r->wall < 0) {
+      continue;
+    }
+    char status[16];
+    if (WIFSIGNALED(r->status)) {
+      snprintf(status, sizeof(status), "signal %d", WTERMSIG(r->status));
+    } else {
+      snprintf(status, sizeof(status), "exit %d", WEXITSTATUS(r->status));
+    }
+    fprintf(out,
+            "%8d %-10s %10.3f %10.3f %10.3f %10ld %8ld %8ld %8ld %8ld  %s\n",
+            (int)r->pid, status, r->wall * 1e3, tv_ms(r->usage.ru_utime),
+            tv_ms(r->usage.ru_stime), r->usage.ru_maxrss, r->usage.ru_minflt,
+            r->usage.ru_majflt, r->usage.ru_nvcsw, r->usage.ru_nivcsw,
+            r->command);
+  }
+  if (st->n > 0) {
+    fprintf(out,
+            "wall_ms over %zu commands: mean %.3f  p50 %.3f  p90 %.3f  "
+            "p99 %.3f  max %.3f\n",
+            st->n, st->mean, st->p50, st->p90, st->p99, st->max);
+  }
+}
+
+static void json_string(const char *s, FILE *out) {
+  fputc('"', out);
+  for (; *s != '\0'; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static void report_json(const profile_t *prof, const wall_stats_t *st,
+                        FILE *out) {
+  fputs("{\"commands\": [", out);
+  const char *sep = "\n";
+  for (size_t i = 0; i < prof->count; i++) {
+    const prof_record_t *r = &prof->records[i];
+    if (r->wall < 0) {
+      continue;
+    }
+    fprintf(out, "%s  {\"pid\": %d, \"command\": ", sep, (int)r->pid);
+    json_string(r->command, out);
+    if (WIFSIGNALED(r->status)) {
+      fprintf(out, ", \"exit_status\": null, \"signal\": %d",
+              WTERMSIG(r->status));
+    } else {
+      fprintf(out, ", \"exit_status\": %d, \"signal\": null",
+              WEXITSTATUS(r->status));
+    }
+    fprintf(out,
+            ", \"wall_ms\": %.3f, \"user_ms\": %.3f, \"sys_ms\": %.3f, "
+            "\"maxrss_kb\": %ld, \"minflt\": %ld, \"majflt\": %ld, "
+            "\"nvcsw\": %ld, \"nivcsw\": %ld}",
+            r->wall * 1e3, tv_ms(r->usage.ru_utime),
+            tv_ms(r->usage.ru_stime), r->usage.ru_maxrss, r->usage.ru_minflt,
+            r->usage.ru_majflt, r->usage.ru_nvcsw, r->usage.ru_nivcsw);
+    sep = ",\n";
+  }
+  fputs("\n],\n\"wall_ms\": ", out);
+  if (st->n > 0) {
+    fprintf(out,
+            "{\"count\": %zu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+            "\"p99\": %.3f, \"max\": %.3f}}\n",
+            st->n, st->mean, st->p50, st->p90, st->p99, st->max);
+  } else {
+    fputs("{\"count\": 0}}\n", out);
+  }
+}
+
+void profile_report(const profile_t *prof, prof_format_t format, FILE *out) {
+  wall_stats_t st = {0};
+  if (wall_stats(prof, &st) < 0) {
+    perror("malloc");
+    return;
+  }
+  if (format == PROF_JSON) {
+    report_json(prof, &st, out);
+  } else {
+    report_table(prof, &st, out);
+  }
+  fflush(out);
+}
@@ -0,0 +1,132 @@
+// Lab 2 - launch latency vs. parent RSS for each launch backend
+//
+// For each ballast size the parent touches that much heap (so it is
+// resident), then launches the program N times per backend. "launch" is the
+// time until launch_program() returns; "roundtrip" adds waiting for exit.
+// The zygote is started before any ballast, as lab2 does, so its launches
+// show what a front end gains by not forking itself.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "launch.h"
+#include "zygote.h"
+
+#define DEFAULT_ITERS 200
+#define DEFAULT_PROGRAM "/bin/true"
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static long rss_kib(void) {
+  FILE *f = fopen("/proc/self/statm", "r");
+  long pages = 0, resident = 0;
+  if (f == NULL) {
+    return -1;
+  }
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+    resident = -1;
+  }
+  fclose(f);
+  return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-n iters] [-p program] [MiB ...]\n"
+          "  MiB  parent ballast sizes to test (default: 0 64 256 1024)\n",
+          prog);
+}
+
+int main(int argc, char *argv[]) {
+  int iters = DEFAULT_ITERS;
+  const char *program = DEFAULT_PROGRAM;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+    switch (opt) {
+    case 'n':
+      iters = atoi(optarg);
+      break;
+    case 'p':
+      program = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (iters < 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  static const size_t default_sizes[] = {0, 64, 256, 1024};
+  size_t nsizes = (size_t)(argc - optind);
+  size_t sizes[nsizes > 0 ? nsizes : 4];
+  if (nsizes == 0) {
+    nsizes = 4;
+    memcpy(sizes, default_sizes, sizeof(default_sizes));
+  } else {
+    for (size_t i = 0; i < nsizes; i++) {
+      sizes[i] = strtoul(argv[optind + (int)i], NULL, 10);
+    }
+  }
+
+  char *child_argv[] = {(char *)program, NULL};
+  if (zygote_start() < 0) {
+    perror("zygote");
+    return EXIT_FAILURE;
+  }
+  printf("ballast_mib,rss_kib,mode,iters,launch_us,roundtrip_us\n");
+
+  for (size_t s = 0; s < nsizes; s++) {
+    size_t bytes = sizes[s] << 20;
+    char *ballast = NULL;
+    if (bytes > 0) {
+      ballast = malloc(bytes);
+      if (ballast == NULL) {
+        perror("malloc");
+        return EXIT_FAILURE;
+      }
+      memset(ballast, 1, bytes); /* fault every page in */
+    }
+    long rss = rss_kib();
+
+    for (int m = LAUNCH_FORK; m <= LAUNCH_ZYGOTE; m++) {
+      double launch_total = 0, roundtrip_total = 0;
+      for (int i = 0; i < iters; i++) {
+        pid_t pid;
+        double t0 = now_us();
+        launch_status_t rc =
+            launch_program(m, program, child_argv, NULL, &pid);
+        double t1 = now_us();
+        if (rc != LAUNCH_OK) {
+          perror(rc == LAUNCH_ERR_FORK ? "fork" : "Exec failure");
+          return EXIT_FAILURE;
+        }
+        if (waitpid(pid, NULL, 0) < 0) {
+          perror("waitpid");
+          return EXIT_FAILURE;
+        }
+        double t2 = now_us();
+        launch_total += t1 - t0;
+        roundtrip_total += t2 - t0;
+      }
+      printf("%zu,%ld,%s,%d,%.1f,%.1f\n", sizes[s], rss,
+             launch_mode_name((launch_mode_t)m), iters, launch_total / iters,
+             roundtrip_total / iters);
+      fflush(stdout);
+    }
+    free(ballast);
+  }
+  zygote_stop();
+  return EXIT_SUCCESS;
+}
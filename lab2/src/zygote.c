@@ -0,0 +1,288 @@
+// Lab 2 - pre-forked spawn server ("zygote")
+#define _GNU_SOURCE
+#include "zygote.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Request: header, then path and argv as consecutive NUL-terminated
+// strings. Descriptors ride along as SCM_RIGHTS: the caller's cwd, then
+// stdin and stdout if redirected.
+typedef struct {
+  uint32_t argc;
+  uint8_t has_in;
+  uint8_t has_out;
+} zreq_hdr_t;
+
+typedef struct {
+  int32_t status; /* launch_status_t */
+  int32_t err;
+  int32_t pid;
+} zreply_t;
+
+#define ZYGOTE_MAX_FDS 3
+
+static int zygote_sock = -1;
+static pid_t zygote_pid = -1;
+static char request[ZYGOTE_MAX_REQUEST];
+
+/* ---------- server ---------- */
+
+static ssize_t recv_request(int sock, int *fds, size_t *nfds) {
+  union {
+    char buf[CMSG_SPACE(ZYGOTE_MAX_FDS * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = {request, sizeof(request)};
+  struct msghdr msg = {.msg_iov = &iov,
+                       .msg_iovlen = 1,
+                       .msg_control = control.buf,
+                       .msg_controllen = sizeof(control.buf)};
+  ssize_t n;
+  do {
+    n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+
+  *nfds = 0;
+  for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL;
+       c = CMSG_NXTHDR(&msg, c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+      size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      memcpy(fds, CMSG_DATA(c), count * sizeof(int));
+      *nfds = count;
+    }
+  }
+  return n;
+}
+
+// Launch one request. The child reports an exec failure through a
+// close-on-exec pipe: EOF means execv succeeded.
+static zreply_t serve(size_t len, const int *fds, size_t nfds) {
+  zreply_t reply = {.status = LAUNCH_ERR_EXEC, .err = EINVAL, .pid = -1};
+  zreq_hdr_t hdr;
+  if (len < sizeof(hdr)) {
+    return reply;
+  }
+  memcpy(&hdr, request, sizeof(hdr));
+  if (nfds != 1u + hdr.has_in + hdr.has_out || hdr.argc > len) {
+    return reply;
+  }
+
+  // Point argv at the strings in place.
+  char *path = request + sizeof(hdr);
+  char *end = request + len;
+  char **argv = malloc((hdr.argc + 1) * sizeof(*argv));
+  if (argv == NULL) {
+    reply.status = LAUNCH_ERR_FORK;
+    reply.err = ENOMEM;
+    return reply;
+  }
+  char *p = path + strnlen(path, (size_t)(end - path)) + 1;
+  for (uint32_t i = 0; i < hdr.argc; i++) {
+    if (p >= end) {
+      free(argv);
+      return reply;
+    }
+    argv[i] = p;
+    p += strnlen(p, (size_t)(end - p)) + 1;
+  }
+  argv[hdr.argc] = NULL;
+
+  int errpipe[2];
+  if (pipe2(errpipe, O_CLOEXEC) < 0) {
+    reply.status = LAUNCH_ERR_FORK;
+    reply.err = errno;
+    free(argv);
+    return reply;
+  }
+  // Raw clone without a new stack behaves like fork(); CLONE_PARENT hands
+  // the child to the front end.
+  pid_t child = (pid_t)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+  if (child == 0) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    int in_fd = hdr.has_in ? fds[1] : -1;
+    int out_fd = hdr.has_out ? fds[1 + hdr.has_in] : -1;
+    if (fchdir(fds[0]) == 0 &&
+        (in_fd < 0 || dup2(in_fd, STDIN_FILENO) >= 0) &&
+        (out_fd < 0 || dup2(out_fd, STDOUT_FILENO) >= 0)) {
+      execv(path, argv);
+    }
+    int err = errno;
+    (void)!write(errpipe[1], &err, sizeof(err));
+    _exit(127);
+  }
+  close(errpipe[1]);
+  if (child < 0) {
+    reply.status = LAUNCH_ERR_FORK;
+    reply.err = errno;
+  } else {
+    int err;
+    ssize_t n;
+    do {
+      n = read(errpipe[0], &err, sizeof(err));
+    } while (n < 0 && errno == EINTR);
+    reply.pid = child;
+    if (n == sizeof(err)) {
+      reply.err = err;
+    } else {
+      reply.status = LAUNCH_OK;
+      reply.err = 0;
+    }
+  }
+  close(errpipe[0]);
+  free(argv);
+  return reply;
+}
+
+static void serve_forever(int sock) {
+  // The front end reports interrupts; the server just stops on EOF.
+  signal(SIGINT, SIG_IGN);
+  signal(SIGQUIT, SIG_IGN);
+  for (;;) {
+    int fds[ZYGOTE_MAX_FDS];
+    size_t nfds;
+    ssize_t n = recv_request(sock, fds, &nfds);
+    if (n <= 0) {
+      _exit(EXIT_SUCCESS);
+    }
+    zreply_t reply = serve((size_t)n, fds, nfds);
+    for (size_t i = 0; i < nfds; i++) {
+      close(fds[i]);
+    }
+    if (send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) < 0) {
+      _exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/* ---------- front end ---------- */
+
+int zygote_start(void) {
+  if (zygote_sock >= 0) {
+    return 0;
+  }
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+    return -1;
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(sv[0]);
+    close(sv[1]);
+    return -1;
+  }
+  if (pid == 0) {
+    close(sv[0]);
+    serve_forever(sv[1]);
+  }
+  close(sv[1]);
+  zygote_sock = sv[0];
+  zygote_pid = pid;
+  return 0;
+}
+
+void zygote_stop(void) {
+  if (zygote_sock < 0) {
+    return;
+  }
+  close(zygote_sock);
+  (void)waitpid(zygote_pid, NULL, 0);
+  zygote_sock = -1;
+  zygote_pid = -1;
+}
+
+static int send_request(size_t len, const int *fds, size_t nfds) {
+  union {
+    char buf[CMSG_SPACE(ZYGOTE_MAX_FDS * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = {request, len};
+  struct msghdr msg = {.msg_iov = &iov,
+                       .msg_iovlen = 1,
+                       .msg_control = control.buf,
+                       .msg_controllen = CMSG_SPACE(nfds * sizeof(int))};
+  struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+  memcpy(CMSG_DATA(c), fds, nfds * sizeof(int));
+
+  ssize_t n;
+  do {
+    n = sendmsg(zygote_sock, &msg, MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  return n < 0 ? -1 : 0;
+}
+
+launch_status_t zygote_launch(const char *path, char *const argv[],
+                              const launch_io_t *io, pid_t *pid) {
+  if (zygote_start() < 0) {
+    return LAUNCH_ERR_FORK;
+  }
+
+  zreq_hdr_t hdr = {0};
+  size_t len = sizeof(hdr);
+  for (const char *s = path; s != NULL; s = argv[hdr.argc++]) {
+    size_t n = strlen(s) + 1;
+    if (len + n > sizeof(request)) {
+      errno = E2BIG;
+      return LAUNCH_ERR_EXEC;
+    }
+    memcpy(request + len, s, n);
+    len += n;
+  }
+  hdr.argc -= 1; /* the loop also counted path */
+
+  int fds[ZYGOTE_MAX_FDS];
+  size_t nfds = 0;
+  fds[nfds++] = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fds[0] < 0) {
+    return LAUNCH_ERR_FORK;
+  }
+  if (io != NULL && io->in_fd >= 0) {
+    hdr.has_in = 1;
+    fds[nfds++] = io->in_fd;
+  }
+  if (io != NULL && io->out_fd >= 0) {
+    hdr.has_out = 1;
+    fds[nfds++] = io->out_fd;
+  }
+  memcpy(request, &hdr, sizeof(hdr));
+
+  zreply_t reply;
+  int rc = send_request(len, fds, nfds);
+  close(fds[0]);
+  if (rc == 0) {
+    ssize_t n;
+    do {
+      n = recv(zygote_sock, &reply, sizeof(reply), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != sizeof(reply)) {
+      rc = -1;
+      errno = n == 0 ? EPIPE : errno;
+    }
+  }
+  if (rc < 0) {
+    return LAUNCH_ERR_FORK;
+  }
+
+  if (reply.status == LAUNCH_ERR_EXEC && reply.pid > 0) {
+    // The failed child is ours to reap, courtesy of CLONE_PARENT.
+    (void)waitpid(reply.pid, NULL, 0);
+  }
+  errno = reply.err;
+  if (reply.status == LAUNCH_OK) {
+    *pid = reply.pid;
+  }
+  return (launch_status_t)reply.status;
+}
@@ -0,0 +1,43 @@
+// Lab 3 - persistent history: append-only log plus offset index
+//
+// `path` holds every entry's text back to back, exactly as typed.
+// `path`.idx holds one 16-byte record per entry: the log offset where the
+// entry ends, a CRC-32 of its text and a CRC-32 of the record itself.
+// Loading maps both files and copies the newest entries into the ring in
+// one go, so it costs a memcpy of the text that is kept, not a re-read.
+//
+// Appends write the text first and the index record second, under an
+// exclusive flock() on the log, so concurrent sessions interleave whole
+// entries. A crash can leave a torn index record or text that was never
+// indexed; both are detected (size, record CRC, text CRC of the last
+// entry) and cut off the next time the file is opened or appended to.
+#ifndef LAB3_HISTFILE_H
+#define LAB3_HISTFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history.h"
+
+typedef struct {
+  uint64_t end;   /* log offset just past this entry */
+  uint32_t crc;   /* CRC-32 of the entry's text */
+  uint32_t check; /* CRC-32 of the 12 bytes above */
+} histfile_rec_t;
+
+typedef struct {
+  int log_fd;
+  int idx_fd;
+  uint64_t entries; /* in the file when it was opened */
+} histfile_t;
+
+/* Open (creating if needed) the history file at `path`, repair a torn
+   tail, and load its newest entries into `h`. Returns 0, or -1 with errno
+   set. */
+int histfile_open(histfile_t *hf, const char *path, history_t *h);
+void histfile_close(histfile_t *hf);
+
+/* Append one entry. Returns 0, or -1 with errno set. */
+int histfile_append(histfile_t *hf, const char *line, size_t len);
+
+#endif
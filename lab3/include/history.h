@@ -0,0 +1,73 @@
+// Lab 3 - command history in one contiguous byte ring
+//
+// Entry text lives back to back in a single power-of-two ring of bytes;
+// an index of start offsets (one per entry slot) finds each entry. Offsets
+// only ever grow and are reduced modulo the ring size on access, so an
+// entry may wrap around the end of the ring. Once the ring is large enough
+// for the live entries, adding a line does no heap allocation. Besides the
+// text, each entry costs one 8-byte offset.
+//
+// Alternatively the history can intern its entries: the slots then hold
+// handles into a reference-counted pool, so a line typed a thousand times
+// is stored once.
+#ifndef LAB3_HISTORY_H
+#define LAB3_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "intern.h"
+
+typedef struct {
+  char *ring;
+  size_t ring_size;  /* bytes, a power of two */
+  intern_pool_t *pool; /* interned mode (no ring) if not NULL */
+  uint64_t *starts;  /* starts[seq % capacity]: byte offset of entry seq,
+                        or its pool handle when interned */
+  size_t capacity;   /* entries kept */
+  uint64_t first;    /* oldest live entry's sequence number */
+  uint64_t next;     /* sequence number the next entry gets */
+  uint64_t head;     /* byte offset just past the newest entry */
+} history_t;
+
+/* Keep the last `capacity` entries, starting with a ring of at least
+   `ring_bytes` bytes. Returns 0, or -1 with errno = ENOMEM. */
+int history_init(history_t *h, size_t capacity, size_t ring_bytes);
+
+/* Same, but interning entries instead of keeping a byte ring. */
+int history_init_interned(history_t *h, size_t capacity);
+
+void history_free(history_t *h);
+
+/* Append line[0, len), evicting the oldest entry once full. The ring grows
+   (doubling) only if the live entries would not fit. Returns 0, or -1 with
+   errno = ENOMEM (the history is unchanged). */
+int history_add(history_t *h, const char *line, size_t len);
+
+/* Append n entries stored back to back, as in a history file: text[0]
+   sits at offset `base`, and entry i ends at the uint64_t offset found
+   `stride` bytes after entry i-1's (so an array of index records can be
+   passed directly). The text is copied in one go and only the entries
+   that will survive are copied at all. Returns 0, or -1 with errno =
+   ENOMEM (the history is unchanged). */
+int history_add_many(history_t *h, const char *text, uint64_t base,
+                     const void *ends, size_t stride, size_t n);
+
+/* Number of live entries (at most capacity). */
+static inline size_t history_count(const history_t *h) {
+  return (size_t)(h->next - h->first);
+}
+
+/* Entry i (0 = oldest) as one piece, or two if it wraps. Returns the
+   number of pieces written to `out`. */
+int history_get(const history_t *h, size_t i, struct iovec out[2]);
+
+/* Write the newest `k` entries (all of them if k exceeds the count), oldest
+   first, exactly as they were added. They are contiguous in the ring, so
+   this is a single writev() of at most two pieces whatever k is (interned
+   entries go out in batches of 1024 pieces). Returns 0, or -1
+   with errno set. */
+int history_write_last(const history_t *h, size_t k, int fd);
+
+#endif
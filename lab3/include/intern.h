@@ -0,0 +1,54 @@
+// Lab 3 - reference-counted pool of distinct strings
+//
+// Each distinct string is stored once and named by a 32-bit handle; an
+// open-addressing hash table finds the handle for a string. Interning an
+// existing string only bumps its count, and the text is freed when the
+// last reference is released.
+#ifndef LAB3_INTERN_H
+#define LAB3_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTERN_NONE UINT32_MAX
+
+typedef struct {
+  char *text;
+  uint32_t len;
+  uint32_t refs; /* 0: slot is free */
+  uint32_t hash; /* for a free slot: the next free slot */
+} intern_str_t;
+
+typedef struct {
+  intern_str_t *strs;
+  uint32_t nstrs; /* slots in use or on the free list */
+  uint32_t cap;
+  uint32_t free_head;
+  uint32_t *table; /* 0 empty, 1 deleted, else handle + 2 */
+  size_t table_size; /* a power of two */
+  size_t table_used; /* live + deleted */
+  size_t live;
+  size_t text_bytes;
+} intern_pool_t;
+
+/* Returns 0, or -1 with errno = ENOMEM. */
+int intern_init(intern_pool_t *pool);
+void intern_free(intern_pool_t *pool);
+
+/* Take a reference to text[0, len), adding it if it is new. Returns the
+   handle, or INTERN_NONE with errno = ENOMEM. */
+uint32_t intern_acquire(intern_pool_t *pool, const char *text, size_t len);
+
+/* Drop a reference; the text goes with the last one. */
+void intern_release(intern_pool_t *pool, uint32_t handle);
+
+static inline const char *intern_text(const intern_pool_t *pool,
+                                      uint32_t handle, size_t *len) {
+  *len = pool->strs[handle].len;
+  return pool->strs[handle].text;
+}
+
+/* Heap bytes held by the pool (text, slots and table), for reports. */
+size_t intern_bytes(const intern_pool_t *pool);
+
+#endif
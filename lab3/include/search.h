@@ -0,0 +1,50 @@
+// Lab 3 - substring search over history through a trigram index
+//
+// Every 3-byte window of every entry maps to a posting list of the entries
+// that contain it, in the order they were added. A query of 3 or more
+// bytes only looks at entries in the rarest of its trigrams' lists (and in
+// all the others), then confirms the match in the text. Entries leave the
+// history oldest first, so eviction just advances the front of each list
+// the entry appears in. Shorter queries fall back to a scan.
+#ifndef LAB3_SEARCH_H
+#define LAB3_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history.h"
+
+typedef struct search_list search_list_t;
+
+typedef struct {
+  search_list_t *lists; /* uthash, keyed by trigram */
+  uint64_t base;        /* postings hold seq - base, in 32 bits */
+  uint64_t first;       /* entries [first, next) are indexed */
+  uint64_t next;
+  bool built;
+  search_list_t **query; /* scratch: the lists of one query */
+  size_t query_cap;
+  char *text; /* scratch: an entry that wraps, made contiguous */
+  size_t text_cap;
+} search_index_t;
+
+void search_init(search_index_t *s);
+void search_free(search_index_t *s);
+
+/* Index entries added to `h` since the last call. The first call indexes
+   the whole history, so a session that never searches pays nothing.
+   Returns 0, or -1 with errno = ENOMEM. */
+int search_sync(search_index_t *s, const history_t *h);
+
+/* Call before an add that evicts `h`'s oldest entry (while its text is
+   still there). No-op until the index has been built. */
+void search_evict_oldest(search_index_t *s, const history_t *h);
+
+/* Find the newest entry older than sequence number `before` whose text
+   contains q[0, len). Returns 1 and sets *seq, 0 if there is none, or -1
+   with errno = ENOMEM. The index must be in sync with `h`. */
+int search_prev(search_index_t *s, const history_t *h, const char *q,
+                size_t len, uint64_t before, uint64_t *seq);
+
+#endif
@@ -0,0 +1,76 @@
+// Lab 3 - history shared between sessions through POSIX shared memory
+//
+// One shm object holds a header, a ring of entry slots and a ring of text
+// bytes. Appending reserves a slot and a run of text bytes with two
+// atomic fetch-adds and never takes a lock or touches a file, so any
+// number of sessions can append at once. Every session pulls new entries
+// from the shared ring into its own history before each command, and so
+// sees the others' commands as soon as they are typed.
+//
+// Each slot carries a sequence number used as a seqlock: 2*i+1 while
+// entry i is being written, 2*i+2 once it is complete. A reader copies an
+// entry out and keeps it only if the slot still holds 2*i+2 and its text
+// bytes have not been reused meanwhile; a slow reader loses the entries
+// writers lapped, never reads a torn one. An entry whose writer dies
+// between reserving and publishing is skipped once newer entries are
+// published and it has stayed unpublished for a couple of seconds; a
+// writer that is merely preempted publishes long before that.
+//
+// The object outlives the sessions using it (it lives in /dev/shm on
+// Linux) until shmhist_unlink() removes the name; sessions still attached
+// keep their mapping.
+#ifndef LAB3_SHMHIST_H
+#define LAB3_SHMHIST_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  _Atomic uint64_t seq; /* 2*i+1 while entry i is written, 2*i+2 after */
+  uint64_t start;       /* text offset, reduced modulo text_size */
+  uint64_t len;
+} shmhist_slot_t;
+
+typedef struct {
+  _Atomic uint64_t magic; /* set last by the creator */
+  uint64_t slots;         /* entry slots */
+  uint64_t text_size;     /* text bytes */
+  _Atomic uint64_t next;  /* index the next appended entry gets */
+  _Atomic uint64_t bytes; /* text bytes reserved so far */
+} shmhist_header_t;
+
+typedef struct {
+  shmhist_header_t *hdr;
+  shmhist_slot_t *slot;
+  char *text;
+  size_t map_size;
+  uint64_t seen;        /* next entry index this session pulls */
+  uint64_t stall_index; /* unpublished entry found overtaken, */
+  uint64_t stall_since; /* and since when (CLOCK_MONOTONIC ns, or 0) */
+  char *buf;            /* copy of the last pulled entry */
+  size_t buf_cap;
+} shmhist_t;
+
+/* Attach to the shared history `name` ("/name", as for shm_open),
+   creating it with room for `slots` entries and `text_size` bytes of text
+   if it does not exist yet; an existing one keeps its own geometry. The
+   entries already in it are pulled by the first shmhist_next() calls.
+   Returns 0, or -1 with errno set. */
+int shmhist_open(shmhist_t *sh, const char *name, size_t slots,
+                 size_t text_size);
+void shmhist_close(shmhist_t *sh);
+
+/* Remove the shared history `name`. Returns 0, or -1 with errno set. */
+int shmhist_unlink(const char *name);
+
+/* Append one entry. Returns 0, or -1 with errno = EMSGSIZE if the line
+   takes more than a quarter of the text ring. */
+int shmhist_append(shmhist_t *sh, const char *line, size_t len);
+
+/* Pull the next entry this session has not seen yet. Returns 1 and points
+   *line at a copy valid until the next call, 0 when caught up (or the
+   next entry is still being written), or -1 with errno = ENOMEM. */
+int shmhist_next(shmhist_t *sh, const char **line, size_t *len);
+
+#endif
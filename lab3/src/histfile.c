@@ -0,0 +1,265 @@
+// Lab 3 - persistent history: append-only log plus offset index
+#define _DEFAULT_SOURCE
+#include "histfile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define REC_SIZE sizeof(histfile_rec_t)
+
+/* ---------- CRC-32 (IEEE, reflected) ---------- */
+
+static uint32_t crc_table[256];
+
+static void crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    crc_table[i] = c;
+  }
+}
+
+// Continue a CRC: start from 0, feed the bytes in any number of pieces.
+static uint32_t crc32_update(uint32_t crc, const void *buf, size_t len) {
+  if (crc_table[1] == 0) {
+    crc_init();
+  }
+  const unsigned char *p = buf;
+  uint32_t c = crc ^ 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; i++) {
+    c = crc_table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+  }
+  return c ^ 0xFFFFFFFFu;
+}
+
+static uint32_t crc32(const void *buf, size_t len) {
+  return crc32_update(0, buf, len);
+}
+
+static uint32_t rec_check(const histfile_rec_t *rec) {
+  return crc32(rec, offsetof(histfile_rec_t, check));
+}
+
+/* ---------- tail repair ---------- */
+
+// Read record i from the index.
+static int read_rec(int fd, uint64_t i, histfile_rec_t *rec) {
+  ssize_t n = pread(fd, rec, REC_SIZE, (off_t)(i * REC_SIZE));
+  return n == (ssize_t)REC_SIZE ? 0 : -1;
+}
+
+// The newest record is trusted only if it is intact and its text is all
+// there and matches. Earlier ones were committed before it was written.
+static int tail_ok(int log_fd, const histfile_rec_t *rec, uint64_t start,
+                   uint64_t log_size) {
+  if (rec->check != rec_check(rec) || rec->end < start ||
+      rec->end > log_size) {
+    return 0;
+  }
+  char buf[4096];
+  uint32_t crc = 0;
+  for (uint64_t off = start; off < rec->end;) {
+    size_t want = rec->end - off < sizeof(buf) ? (size_t)(rec->end - off)
+                                               : sizeof(buf);
+    ssize_t n = pread(log_fd, buf, want, (off_t)off);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return -1;
+    }
+    if (n == 0) {
+      return 0;
+    }
+    crc = crc32_update(crc, buf, (size_t)n);
+    off += (uint64_t)n;
+  }
+  return crc == rec->crc;
+}
+
+// With the lock held: drop a torn index record, index records whose text
+// is missing or corrupt, and log bytes past the last indexed entry.
+// Returns the number of committed entries, or -1.
+static int64_t repair(histfile_t *hf, uint64_t *log_end) {
+  struct stat st_log, st_idx;
+  if (fstat(hf->log_fd, &st_log) < 0 || fstat(hf->idx_fd, &st_idx) < 0) {
+    return -1;
+  }
+  uint64_t log_size = (uint64_t)st_log.st_size;
+  uint64_t count = (uint64_t)st_idx.st_size / REC_SIZE;
+
+  uint64_t end = 0;
+  while (count > 0) {
+    histfile_rec_t rec, prev = {0};
+    if (read_rec(hf->idx_fd, count - 1, &rec) < 0 ||
+        (count > 1 && read_rec(hf->idx_fd, count - 2, &prev) < 0)) {
+      return -1;
+    }
+    int ok = tail_ok(hf->log_fd, &rec, prev.end, log_size);
+    if (ok < 0) {
+      return -1;
+    }
+    if (ok) {
+      end = rec.end;
+      break;
+    }
+    count--;
+  }
+
+  if ((uint64_t)st_idx.st_size != count * REC_SIZE &&
+      ftruncate(hf->idx_fd, (off_t)(count * REC_SIZE)) < 0) {
+    return -1;
+  }
+  if (log_size != end && ftruncate(hf->log_fd, (off_t)end) < 0) {
+    return -1;
+  }
+  *log_end = end;
+  return (int64_t)count;
+}
+
+/* ---------- open / load ---------- */
+
+// Copy the newest entries (at most the history's capacity) into `h`.
+static int load(histfile_t *hf, history_t *h, uint64_t count,
+                uint64_t log_end) {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t n = count < h->capacity ? count : h->capacity;
+  uint64_t first = count - n;
+
+  // Map only the tail of each file that is needed; offsets must be
+  // page-aligned.
+  uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t idx_from = (first > 0 ? first - 1 : 0) * REC_SIZE;
+  uint64_t idx_map = idx_from & ~(page - 1);
+  size_t idx_len = (size_t)(count * REC_SIZE - idx_map);
+  char *idx = mmap(NULL, idx_len, PROT_READ, MAP_SHARED, hf->idx_fd,
+                   (off_t)idx_map);
+  if (idx == MAP_FAILED) {
+    return -1;
+  }
+  const histfile_rec_t *recs =
+      (const histfile_rec_t *)(idx + (first * REC_SIZE - idx_map));
+  uint64_t base = first > 0 ? recs[-1].end : 0;
+
+  int rc = 0;
+  uint64_t log_map = base & ~(page - 1);
+  size_t log_len = (size_t)(log_end - log_map);
+  char *log = "";
+  if (log_len > 0) {
+    log = mmap(NULL, log_len, PROT_READ, MAP_SHARED, hf->log_fd,
+               (off_t)log_map);
+    if (log == MAP_FAILED) {
+      munmap(idx, idx_len);
+      return -1;
+    }
+    // The kernel reads the tail ahead instead of faulting page by page.
+    posix_madvise(log, log_len, POSIX_MADV_SEQUENTIAL);
+  }
+  rc = history_add_many(h, log + (base - log_map), base, &recs[0].end,
+                        REC_SIZE, (size_t)n);
+  if (log_len > 0) {
+    munmap(log, log_len);
+  }
+  munmap(idx, idx_len);
+  return rc;
+}
+
+int histfile_open(histfile_t *hf, const char *path, history_t *h) {
+  size_t n = strlen(path);
+  char *idx_path = malloc(n + sizeof(".idx"));
+  if (idx_path == NULL) {
+    return -1;
+  }
+  memcpy(idx_path, path, n);
+  memcpy(idx_path + n, ".idx", sizeof(".idx"));
+
+  hf->log_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  hf->idx_fd = open(idx_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  free(idx_path);
+  if (hf->log_fd < 0 || hf->idx_fd < 0) {
+    histfile_close(hf);
+    return -1;
+  }
+
+  if (flock(hf->log_fd, LOCK_EX) < 0) {
+    histfile_close(hf);
+    return -1;
+  }
+  uint64_t log_end;
+  int64_t count = repair(hf, &log_end);
+  int rc = count < 0 ? -1 : load(hf, h, (uint64_t)count, log_end);
+  int saved = errno;
+  flock(hf->log_fd, LOCK_UN);
+  if (rc < 0) {
+    histfile_close(hf);
+    errno = saved;
+    return -1;
+  }
+  hf->entries = (uint64_t)count;
+  return 0;
+}
+
+void histfile_close(histfile_t *hf) {
+  if (hf->log_fd >= 0) {
+    close(hf->log_fd);
+  }
+  if (hf->idx_fd >= 0) {
+    close(hf->idx_fd);
+  }
+  hf->log_fd = hf->idx_fd = -1;
+}
+
+/* ---------- append ---------- */
+
+static int pwrite_all(int fd, const void *buf, size_t len, uint64_t off) {
+  const char *p = buf;
+  while (len > 0) {
+    ssize_t n = pwrite(fd, p, len, (off_t)off);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    p += n;
+    len -= (size_t)n;
+    off += (uint64_t)n;
+  }
+  return 0;
+}
+
+int histfile_append(histfile_t *hf, const char *line, size_t len) {
+  if (flock(hf->log_fd, LOCK_EX) < 0) {
+    return -1;
+  }
+  // Other sessions may have appended (or crashed mid-append) since we
+  // last looked, so find the real end under the lock.
+  uint64_t end;
+  int64_t count = repair(hf, &end);
+  int rc = -1;
+  if (count >= 0) {
+    histfile_rec_t rec = {.end = end + len, .crc = crc32(line, len)};
+    rec.check = rec_check(&rec);
+    // Text before index: an index record never points at missing text.
+    if (pwrite_all(hf->log_fd, line, len, end) == 0 &&
+        pwrite_all(hf->idx_fd, &rec, REC_SIZE,
+                   (uint64_t)count * REC_SIZE) == 0) {
+      rc = 0;
+    }
+  }
+  int saved = errno;
+  flock(hf->log_fd, LOCK_UN);
+  errno = saved;
+  return rc;
+}
@@ -0,0 +1,272 @@
+// Lab 3 - command history in one contiguous byte ring
+#include "history.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#define WRITE_BATCH 1024 /* iovecs per writev(); Linux's IOV_MAX */
+
+static size_t round_pow2(size_t n) {
+  size_t p = 64;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+int history_init(history_t *h, size_t capacity, size_t ring_bytes) {
+  h->ring_size = round_pow2(ring_bytes);
+  h->ring = malloc(h->ring_size);
+  h->pool = NULL;
+  h->capacity = capacity > 0 ? capacity : 1;
+  h->starts = malloc(h->capacity * sizeof(*h->starts));
+  h->first = 0;
+  h->next = 0;
+  h->head = 0;
+  if (h->ring == NULL || h->starts == NULL) {
+    history_free(h);
+    errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+int history_init_interned(history_t *h, size_t capacity) {
+  h->ring = NULL;
+  h->ring_size = 0;
+  h->capacity = capacity > 0 ? capacity : 1;
+  h->starts = malloc(h->capacity * sizeof(*h->starts));
+  h->pool = malloc(sizeof(*h->pool));
+  h->first = 0;
+  h->next = 0;
+  h->head = 0;
+  if (h->starts == NULL || h->pool == NULL || intern_init(h->pool) < 0) {
+    free(h->pool);
+    h->pool = NULL;
+    history_free(h);
+    errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+void history_free(history_t *h) {
+  if (h->pool != NULL) {
+    intern_free(h->pool);
+    free(h->pool);
+    h->pool = NULL;
+  }
+  free(h->ring);
+  free(h->starts);
+  h->ring = NULL;
+  h->starts = NULL;
+  h->first = h->next = h->head = 0;
+}
+
+/* ---------- ring access ---------- */
+
+// Split ring bytes [pos, pos + len) into at most two contiguous pieces.
+static int ring_pieces(const char *ring, size_t size, uint64_t pos,
+                       size_t len, struct iovec out[2]) {
+  size_t at = (size_t)(pos & (size - 1));
+  size_t first = size - at < len ? size - at : len;
+  out[0] = (struct iovec){(void *)(ring + at), first};
+  if (first == len) {
+    return 1;
+  }
+  out[1] = (struct iovec){(void *)ring, len - first};
+  return 2;
+}
+
+static void ring_write(history_t *h, uint64_t pos, const char *src,
+                       size_t len) {
+  struct iovec piece[2];
+  int n = ring_pieces(h->ring, h->ring_size, pos, len, piece);
+  for (int i = 0; i < n; i++) {
+    memcpy(piece[i].iov_base, src, piece[i].iov_len);
+    src += piece[i].iov_len;
+  }
+}
+
+// Double the ring until `need` bytes fit, keeping the bytes from `start`
+// to the head at the same offsets.
+static int ring_grow(history_t *h, uint64_t start, size_t need) {
+  size_t size = round_pow2(need);
+  char *ring = malloc(size);
+  if (ring == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  struct iovec piece[2];
+  int n = ring_pieces(h->ring, h->ring_size, start,
+                      (size_t)(h->head - start), piece);
+  history_t grown = *h;
+  grown.ring = ring;
+  grown.ring_size = size;
+  uint64_t pos = start;
+  for (int i = 0; i < n; i++) {
+    ring_write(&grown, pos, piece[i].iov_base, piece[i].iov_len);
+    pos += piece[i].iov_len;
+  }
+  free(h->ring);
+  h->ring = ring;
+  h->ring_size = size;
+  return 0;
+}
+
+/* ---------- entries ---------- */
+
+static uint64_t entry_end(const history_t *h, uint64_t seq) {
+  return seq + 1 == h->next ? h->head : h->starts[(seq + 1) % h->capacity];
+}
+
+static int intern_add(history_t *h, const char *line, size_t len) {
+  uint32_t handle = intern_acquire(h->pool, line, len);
+  if (handle == INTERN_NONE) {
+    return -1;
+  }
+  if (history_count(h) == h->capacity) {
+    intern_release(h->pool, (uint32_t)h->starts[h->first % h->capacity]);
+    h->first++;
+  }
+  h->starts[h->next++ % h->capacity] = handle;
+  return 0;
+}
+
+int history_add(history_t *h, const char *line, size_t len) {
+  if (h->pool != NULL) {
+    return intern_add(h, line, len);
+  }
+  // The oldest entry is evicted first if the index is full, so only the
+  // survivors and the new line need to fit.
+  uint64_t keep_from = h->first + (history_count(h) == h->capacity);
+  uint64_t live_start =
+      keep_from < h->next ? h->starts[keep_from % h->capacity] : h->head;
+  size_t need = (size_t)(h->head - live_start) + len;
+  if (need > h->ring_size && ring_grow(h, live_start, need) < 0) {
+    return -1;
+  }
+
+  h->first = keep_from;
+  h->starts[h->next % h->capacity] = h->head;
+  ring_write(h, h->head, line, len);
+  h->head += len;
+  h->next++;
+  return 0;
+}
+
+static uint64_t end_at(const void *ends, size_t stride, size_t i) {
+  uint64_t end;
+  memcpy(&end, (const char *)ends + i * stride, sizeof(end));
+  return end;
+}
+
+int history_add_many(history_t *h, const char *text, uint64_t base,
+                     const void *ends, size_t stride, size_t n) {
+  if (n == 0) {
+    return 0;
+  }
+  // Entries that would be evicted by the later ones are never copied.
+  size_t skip = n > h->capacity ? n - h->capacity : 0;
+  uint64_t from = skip > 0 ? end_at(ends, stride, skip - 1) : base;
+  if (h->pool != NULL) {
+    for (size_t i = skip; i < n; i++) {
+      uint64_t end = end_at(ends, stride, i);
+      if (intern_add(h, text + (from - base), (size_t)(end - from)) < 0) {
+        return -1;
+      }
+      from = end;
+    }
+    return 0;
+  }
+  size_t len = (size_t)(end_at(ends, stride, n - 1) - from);
+  size_t added = n - skip;
+
+  uint64_t keep_from = h->first;
+  if (history_count(h) + added > h->capacity) {
+    keep_from = h->next + added - h->capacity;
+  }
+  uint64_t live_start =
+      keep_from < h->next ? h->starts[keep_from % h->capacity] : h->head;
+  size_t need = (size_t)(h->head - live_start) + len;
+  if (need > h->ring_size && ring_grow(h, live_start, need) < 0) {
+    return -1;
+  }
+
+  h->first = keep_from;
+  uint64_t start = h->head;
+  for (size_t i = skip; i < n; i++) {
+    h->starts[h->next++ % h->capacity] = start;
+    start = h->head + (end_at(ends, stride, i) - from);
+  }
+  ring_write(h, h->head, text + (from - base), len);
+  h->head += len;
+  return 0;
+}
+
+int history_get(const history_t *h, size_t i, struct iovec out[2]) {
+  uint64_t seq = h->first + i;
+  if (h->pool != NULL) {
+    size_t len;
+    const char *text =
+        intern_text(h->pool, (uint32_t)h->starts[seq % h->capacity], &len);
+    out[0] = (struct iovec){(void *)text, len};
+    return 1;
+  }
+  uint64_t start = h->starts[seq % h->capacity];
+  return ring_pieces(h->ring, h->ring_size, start,
+                     (size_t)(entry_end(h, seq) - start), out);
+}
+
+// writev() all of iov[0, n), resuming after short writes.
+static int writev_all(int fd, struct iovec *iov, int n) {
+  while (n > 0) {
+    ssize_t wrote = writev(fd, iov, n);
+    if (wrote < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    // Short write (pipe, terminal): skip what went out and retry the rest.
+    while (n > 0 && (size_t)wrote >= iov->iov_len) {
+      wrote -= (ssize_t)iov->iov_len;
+      iov++;
+      n--;
+    }
+    if (n > 0) {
+      iov->iov_base = (char *)iov->iov_base + wrote;
+      iov->iov_len -= (size_t)wrote;
+    }
+  }
+  return 0;
+}
+
+int history_write_last(const history_t *h, size_t k, int fd) {
+  size_t count = history_count(h);
+  if (k > count) {
+    k = count;
+  }
+  if (h->pool != NULL) {
+    struct iovec batch[WRITE_BATCH];
+    int n = 0;
+    for (size_t i = count - k; i < count; i++) {
+      n += history_get(h, i, &batch[n]);
+      if (n == WRITE_BATCH && writev_all(fd, batch, n) < 0) {
+        return -1;
+      }
+      n %= WRITE_BATCH;
+    }
+    return writev_all(fd, batch, n);
+  }
+  if (k == 0) {
+    return 0;
+  }
+  uint64_t start = h->starts[(h->next - k) % h->capacity];
+  struct iovec piece[2];
+  int n = ring_pieces(h->ring, h->ring_size, start, (size_t)(h->head - start),
+                      piece);
+  return writev_all(fd, piece, n);
+}
@@ -0,0 +1,315 @@
+// Lab 3 - history throughput, allocations and footprint per line
+//
+// Feeds the same generated lines through the original lab3 loop (a malloc'd
+// string per slot plus a comparison copy per line), the byte ring and the
+// interned history, and writes one CSV row per implementation. -u sets how
+// many distinct lines the workload cycles through; -u 0 makes every line
+// unique (a sequence number is prefixed). bytes_per_entry is the
+// history's whole footprint (text, index, allocator overhead) divided by
+// the live entries. Then "print k" is timed on the full ring for a few k;
+// those rows report ns per printed entry. The executable is linked with
+// --wrap for malloc/calloc/realloc/free, so every allocation made by this
+// program and the history library is counted.
+#define _GNU_SOURCE // memfd_create
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "history.h"
+
+#define DEFAULT_LINES 1000000
+#define DEFAULT_CAPACITY 5
+#define POOL_LINES 65536 /* distinct generated lines */
+#define PRINT_REPS 20
+
+/* ---------- allocation counters ---------- */
+
+// volatile: the compiler assumes malloc() never touches our globals, and
+// would otherwise keep them in registers across the calls.
+static volatile size_t allocs, frees;
+static volatile size_t sink; /* keeps the "print" checks from folding away */
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n) {
+  allocs++;
+  return __real_malloc(n);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  allocs++;
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t n) {
+  allocs++;
+  return __real_realloc(p, n);
+}
+
+void __wrap_free(void *p) {
+  if (p != NULL) {
+    frees++;
+  }
+  __real_free(p);
+}
+
+/* ---------- workload ---------- */
+
+static char *lines[POOL_LINES];
+static size_t lens[POOL_LINES];
+static size_t distinct = POOL_LINES;
+
+// Line i of the workload; valid until the next call.
+static char *workload_line(size_t i, size_t *len) {
+  static char unique[128];
+  if (distinct == 0) {
+    *len = (size_t)snprintf(unique, sizeof(unique), "%zu %s", i,
+                            lines[i % POOL_LINES]);
+    return unique;
+  }
+  *len = lens[i % distinct];
+  return lines[i % distinct];
+}
+
+/* ---------- the original lab3 loop ---------- */
+
+static void legacy_add(char **history, int *current_index, char *line,
+                       int size) {
+  if (history[*current_index] != NULL) {
+    free(history[*current_index]);
+  }
+  history[*current_index] = malloc(strlen(line) + 1);
+  if (history[*current_index] != NULL) {
+    strcpy(history[*current_index], line);
+  }
+  *current_index = (*current_index + 1) % size;
+}
+
+// Returns the footprint per live entry.
+static double run_legacy(size_t n, size_t capacity) {
+  char **history = calloc(capacity, sizeof(*history));
+  int current_index = 0;
+  size_t prints = 0;
+  if (history == NULL) {
+    perror("calloc");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < n; i++) {
+    size_t len;
+    char *line = workload_line(i, &len);
+    char *line_for_comparison = malloc(strlen(line) + 1);
+    strcpy(line_for_comparison, line);
+    char *newline_pos = strchr(line_for_comparison, '\n');
+    if (newline_pos != NULL) {
+      *newline_pos = '\0';
+    }
+    legacy_add(history, &current_index, line, (int)capacity);
+    prints += strcmp(line_for_comparison, "print") == 0;
+    free(line_for_comparison);
+  }
+  sink = prints;
+
+  size_t bytes = capacity * sizeof(*history), live = 0;
+  for (size_t i = 0; i < capacity; i++) {
+    if (history[i] != NULL) {
+      bytes += malloc_usable_size(history[i]) + sizeof(size_t);
+      live++;
+    }
+    free(history[i]);
+  }
+  free(history);
+  return (double)bytes / (double)(live ? live : 1);
+}
+
+/* ---------- byte ring / interned ---------- */
+
+static void run_history(history_t *h, size_t n) {
+  size_t prints = 0;
+  for (size_t i = 0; i < n; i++) {
+    size_t len;
+    const char *line = workload_line(i, &len);
+    if (history_add(h, line, len) < 0) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    prints += len == 6 && memcmp(line, "print\n", 6) == 0;
+  }
+  sink = prints;
+}
+
+static size_t history_bytes(const history_t *h) {
+  size_t bytes = h->ring_size + h->capacity * sizeof(*h->starts);
+  return h->pool != NULL ? bytes + intern_bytes(h->pool) : bytes;
+}
+
+/* ---------- driver ---------- */
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-n lines] [-c capacity] [-u distinct] "
+          "[-o results.csv]\n"
+          "  -n  lines fed to each implementation (default %d)\n"
+          "  -c  history capacity in entries (default %d)\n"
+          "  -u  distinct lines in the workload, 0 = all unique "
+          "(default and max %d)\n"
+          "  -o  append CSV rows to this file instead of stdout\n",
+          prog, DEFAULT_LINES, DEFAULT_CAPACITY, POOL_LINES);
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = DEFAULT_LINES;
+  size_t capacity = DEFAULT_CAPACITY;
+  const char *csv_path = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:c:u:o:")) != -1) {
+    switch (opt) {
+    case 'n':
+      n = strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      capacity = strtoul(optarg, NULL, 10);
+      break;
+    case 'u':
+      distinct = strtoul(optarg, NULL, 10);
+      break;
+    case 'o':
+      csv_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (n == 0 || capacity == 0 || distinct > POOL_LINES) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *csv = stdout;
+  if (csv_path != NULL) {
+    csv = fopen(csv_path, "a");
+    if (csv == NULL) {
+      perror(csv_path);
+      return EXIT_FAILURE;
+    }
+  }
+  // "print k" output goes to an in-memory file, rewound each time, so the
+  // timing includes copying the bytes but not a disk.
+  int out_fd = memfd_create("history_bench", 0);
+  if (out_fd < 0) {
+    perror("memfd_create");
+    return EXIT_FAILURE;
+  }
+
+  // Lines of 1-80 bytes plus a newline, with an occasional "print".
+  char *text = malloc(POOL_LINES * 82);
+  if (text == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  char *p = text;
+  for (size_t i = 0; i < POOL_LINES; i++) {
+    lines[i] = p;
+    if (rng() % 100 == 0) {
+      p += sprintf(p, "print\n");
+    } else {
+      size_t len = 1 + rng() % 80;
+      for (size_t k = 0; k < len; k++) {
+        *p++ = (char)('a' + rng() % 26);
+      }
+      *p++ = '\n';
+    }
+    *p++ = '\0';
+    lens[i] = (size_t)(p - lines[i]) - 1;
+  }
+
+  if (csv_path == NULL || ftell(csv) == 0) {
+    fprintf(csv, "impl,lines,capacity,distinct,allocs,allocs_per_line,"
+                 "ns_per_line,bytes_per_entry\n");
+  }
+
+  allocs = frees = 0;
+  double t0 = now_seconds();
+  double legacy_bytes = run_legacy(n, capacity);
+  double secs = now_seconds() - t0;
+  fprintf(csv, "malloc,%zu,%zu,%zu,%zu,%.3f,%.1f,%.1f\n", n, capacity,
+          distinct, allocs, (double)allocs / (double)n,
+          secs * 1e9 / (double)n, legacy_bytes);
+  fflush(csv);
+
+  history_t h;
+  for (int interned = 1; interned >= 0; interned--) {
+    allocs = frees = 0;
+    t0 = now_seconds();
+    if ((interned ? history_init_interned(&h, capacity)
+                  : history_init(&h, capacity, 4096)) < 0) {
+      perror("malloc");
+      return EXIT_FAILURE;
+    }
+    run_history(&h, n);
+    secs = now_seconds() - t0;
+    fprintf(csv, "%s,%zu,%zu,%zu,%zu,%.3f,%.1f,%.1f\n",
+            interned ? "interned" : "ring", n, capacity, distinct, allocs,
+            (double)allocs / (double)n, secs * 1e9 / (double)n,
+            (double)history_bytes(&h) / (double)history_count(&h));
+    fflush(csv);
+    if (interned) {
+      history_free(&h);
+    }
+  }
+
+  // "print k" on the byte ring, still full from the last run.
+  size_t live = history_count(&h);
+  static const size_t ks[] = {10, 1000, 100000, 10000000};
+  for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); i++) {
+    size_t k = ks[i] < live ? ks[i] : live;
+    allocs = 0;
+    t0 = now_seconds();
+    for (int r = 0; r < PRINT_REPS; r++) {
+      if (lseek(out_fd, 0, SEEK_SET) < 0 ||
+          history_write_last(&h, k, out_fd) < 0) {
+        perror("write");
+        return EXIT_FAILURE;
+      }
+    }
+    secs = (now_seconds() - t0) / PRINT_REPS;
+    fprintf(csv, "print_last,%zu,%zu,%zu,%zu,%.3f,%.3f,\n", k, capacity,
+            distinct, allocs, (double)allocs / (double)k,
+            secs * 1e9 / (double)k);
+    if (k == live) {
+      break;
+    }
+  }
+
+  history_free(&h);
+  free(text);
+  close(out_fd);
+  if (csv != stdout) {
+    fclose(csv);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+// Lab 3 - reference-counted pool of distinct strings
+#include "intern.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_EMPTY 0
+#define SLOT_DELETED 1
+
+// FNV-1a; history lines are short, so this is not the bottleneck.
+static uint32_t hash_text(const char *text, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ (unsigned char)text[i]) * 16777619u;
+  }
+  return h;
+}
+
+int intern_init(intern_pool_t *pool) {
+  memset(pool, 0, sizeof(*pool));
+  pool->free_head = INTERN_NONE;
+  pool->table_size = 64;
+  pool->table = calloc(pool->table_size, sizeof(*pool->table));
+  if (pool->table == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+void intern_free(intern_pool_t *pool) {
+  for (uint32_t i = 0; i < pool->nstrs; i++) {
+    if (pool->strs[i].refs > 0) {
+      free(pool->strs[i].text);
+    }
+  }
+  free(pool->strs);
+  free(pool->table);
+  memset(pool, 0, sizeof(*pool));
+  pool->free_head = INTERN_NONE;
+}
+
+size_t intern_bytes(const intern_pool_t *pool) {
+  return pool->text_bytes + pool->cap * sizeof(*pool->strs) +
+         pool->table_size * sizeof(*pool->table);
+}
+
+/* ---------- hash table ---------- */
+
+// Rehash into a table sized for the live strings, dropping deletions.
+static int rehash(intern_pool_t *pool) {
+  size_t size = 64;
+  while (size < pool->live * 2 + 2) {
+    size <<= 1;
+  }
+  uint32_t *table = calloc(size, sizeof(*table));
+  if (table == NULL) {
+    return -1;
+  }
+  for (size_t i = 0; i < pool->table_size; i++) {
+    uint32_t v = pool->table[i];
+    if (v > SLOT_DELETED) {
+      size_t at = pool->strs[v - 2].hash & (size - 1);
+      while (table[at] != SLOT_EMPTY) {
+        at = (at + 1) & (size - 1);
+      }
+      table[at] = v;
+    }
+  }
+  free(pool->table);
+  pool->table = table;
+  pool->table_size = size;
+  pool->table_used = pool->live;
+  return 0;
+}
+
+static uint32_t new_slot(intern_pool_t *pool) {
+  if (pool->free_head != INTERN_NONE) {
+    uint32_t handle = pool->free_head;
+    pool->free_head = pool->strs[handle].hash;
+    return handle;
+  }
+  if (pool->nstrs == pool->cap) {
+    uint32_t cap = pool->cap ? pool->cap * 2 : 64;
+    intern_str_t *strs = realloc(pool->strs, cap * sizeof(*strs));
+    if (strs == NULL) {
+      return INTERN_NONE;
+    }
+    pool->strs = strs;
+    pool->cap = cap;
+  }
+  return pool->nstrs++;
+}
+
+uint32_t intern_acquire(intern_pool_t *pool, const char *text, size_t len) {
+  uint32_t hash = hash_text(text, len);
+  size_t mask = pool->table_size - 1;
+  size_t at = hash & mask;
+  size_t hole = SIZE_MAX;
+  for (uint32_t v; (v = pool->table[at]) != SLOT_EMPTY; at = (at + 1) & mask) {
+    if (v == SLOT_DELETED) {
+      hole = hole == SIZE_MAX ? at : hole;
+      continue;
+    }
+    intern_str_t *s = &pool->strs[v - 2];
+    if (s->hash == hash && s->len == len && memcmp(s->text, text, len) == 0) {
+      s->refs++;
+      return v - 2;
+    }
+  }
+
+  // New string. Keep the table at most 3/4 full, counting deletions.
+  if (hole == SIZE_MAX && (pool->table_used + 1) * 4 > pool->table_size * 3) {
+    if (rehash(pool) < 0) {
+      errno = ENOMEM;
+      return INTERN_NONE;
+    }
+    return intern_acquire(pool, text, len);
+  }
+  char *copy = malloc(len ? len : 1);
+  uint32_t handle = copy != NULL ? new_slot(pool) : INTERN_NONE;
+  if (handle == INTERN_NONE) {
+    free(copy);
+    errno = ENOMEM;
+    return INTERN_NONE;
+  }
+  memcpy(copy, text, len);
+  pool->strs[handle] =
+      (intern_str_t){.text = copy, .len = (uint32_t)len, .refs = 1,
+                     .hash = hash};
+  if (hole != SIZE_MAX) {
+    at = hole;
+  } else {
+    pool->table_used++;
+  }
+  pool->table[at] = handle + 2;
+  pool->live++;
+  pool->text_bytes += len;
+  return handle;
+}
+
+void intern_release(intern_pool_t *pool, uint32_t handle) {
+  intern_str_t *s = &pool->strs[handle];
+  if (--s->refs > 0) {
+    return;
+  }
+  size_t mask = pool->table_size - 1;
+  size_t at = s->hash & mask;
+  while (pool->table[at] != handle + 2) {
+    at = (at + 1) & mask;
+  }
+  pool->table[at] = SLOT_DELETED;
+  pool->live--;
+  pool->text_bytes -= s->len;
+  free(s->text);
+  s->text = NULL;
+  s->hash = pool->free_head;
+  pool->free_head = handle;
+}
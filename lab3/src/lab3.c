@@ -0,0 +1,436 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "histfile.h"
+#include "history.h"
+#include "search.h"
+#include "shmhist.h"
+
+#define HISTORY_SIZE 5 // default; override with -n or $LAB3_HISTORY_SIZE
+#define HISTORY_BYTES 4096 // initial ring; grows if the entries don't fit
+#define SHARED_BYTES_PER_ENTRY 256 // text room per slot of a new shared ring
+#define SHARED_MIN_BYTES (1 << 20)
+
+typedef struct {
+  history_t history;
+  search_index_t index;
+  histfile_t histfile;
+  const char *path; // history file, or NULL
+  shmhist_t shared;
+  bool sharing;     // entries go through the shared ring
+  uint64_t *found;  // search matches, reused between searches
+  size_t found_cap;
+} session_t;
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [-n entries] [-f file] [-s name] [-d] [-u]\n",
+          prog);
+  fprintf(stderr, "  -n  history capacity (default: $LAB3_HISTORY_SIZE "
+                  "or %d)\n",
+          HISTORY_SIZE);
+  fprintf(stderr, "  -f  keep history in this file across sessions "
+                  "(default: $LAB3_HISTFILE, or none)\n");
+  fprintf(stderr, "  -s  share history live with other sessions using "
+                  "this name\n      (default: $LAB3_SHM, or none)\n");
+  fprintf(stderr, "  -d  store each distinct line once (for histories "
+                  "full of repeats)\n");
+  fprintf(stderr, "  -u  remove the shared history named by -s and exit "
+                  "(it outlives\n      every session otherwise)\n");
+  fprintf(stderr, "Commands: print (whole history), print k (last k "
+                  "entries),\n");
+  fprintf(stderr, "          search text (entries containing text), "
+                  "isearch (incremental, ^R for older)\n");
+}
+
+static int parse_size(const char *s, size_t *out) {
+  char *end;
+  errno = 0;
+  unsigned long long n = strtoull(s, &end, 10);
+  if (errno != 0 || end == s || *end != '\0' || n == 0) {
+    return -1;
+  }
+  *out = (size_t)n;
+  return 0;
+}
+
+// Check a line against a command, ignoring the trailing newline
+static int is_command(const char *line, size_t len, const char *command) {
+  if (len > 0 && line[len - 1] == '\n') {
+    len--;
+  }
+  return len == strlen(command) && memcmp(line, command, len) == 0;
+}
+
+// Recognise "print" and "print k" (trailing newline ignored). Sets *k to
+// the number of entries to show, or SIZE_MAX for all of them.
+static int is_print(const char *line, size_t len, size_t *k) {
+  if (len > 0 && line[len - 1] == '\n') {
+    len--;
+  }
+  if (len < 5 || memcmp(line, "print", 5) != 0) {
+    return 0;
+  }
+  if (len == 5) {
+    *k = SIZE_MAX;
+    return 1;
+  }
+  if (line[5] != ' ') {
+    return 0;
+  }
+  // Parse the count without copying the line
+  size_t n = 0;
+  size_t i = 6;
+  if (i == len) {
+    return 0;
+  }
+  for (; i < len; i++) {
+    if (line[i] < '0' || line[i] > '9') {
+      return 0;
+    }
+    n = n > SIZE_MAX / 10 ? SIZE_MAX : n * 10 + (size_t)(line[i] - '0');
+  }
+  *k = n;
+  return 1;
+}
+
+// Recognise "search text"; the query is the rest of the line
+static int is_search(const char *line, size_t len, const char **query,
+                     size_t *qlen) {
+  if (len > 0 && line[len - 1] == '\n') {
+    len--;
+  }
+  if (len < 8 || memcmp(line, "search ", 7) != 0) {
+    return 0;
+  }
+  *query = line + 7;
+  *qlen = len - 7;
+  return 1;
+}
+
+static void write_entry(const history_t *history, uint64_t seq, bool newline) {
+  struct iovec piece[2];
+  int n = history_get(history, (size_t)(seq - history->first), piece);
+  for (int i = 0; i < n; i++) {
+    size_t len = piece[i].iov_len;
+    // Drop the stored newline when the caller wants the line open
+    if (!newline && i == n - 1 && len > 0 &&
+        ((char *)piece[i].iov_base)[len - 1] == '\n') {
+      len--;
+    }
+    fwrite(piece[i].iov_base, 1, len, stdout);
+  }
+}
+
+// Add a line to history and the search index
+static int add_local(session_t *s, const char *line, size_t len) {
+  search_evict_oldest(&s->index, &s->history);
+  if (history_add(&s->history, line, len) < 0) {
+    perror("malloc");
+    return -1;
+  }
+  return 0;
+}
+
+// Bring in what every session (this one included) appended to the shared
+// ring since the last call
+static int pull_shared(session_t *s) {
+  const char *line;
+  size_t len;
+  int rc;
+  while ((rc = shmhist_next(&s->shared, &line, &len)) > 0) {
+    if (add_local(s, line, len) < 0) {
+      return -1;
+    }
+  }
+  if (rc < 0) {
+    perror("malloc");
+  }
+  return rc;
+}
+
+// Record a typed line in the history file and either the shared ring or
+// the local history. A line too long for the shared ring stays local.
+static int remember(session_t *s, const char *line, size_t len) {
+  if (s->histfile.log_fd >= 0 &&
+      histfile_append(&s->histfile, line, len) < 0) {
+    perror(s->path);
+    return -1;
+  }
+  if (s->sharing && shmhist_append(&s->shared, line, len) == 0) {
+    return pull_shared(s);
+  }
+  if (s->sharing && pull_shared(s) < 0) {
+    return -1;
+  }
+  return add_local(s, line, len);
+}
+
+// Print every entry containing the query, oldest first
+static int run_search(session_t *s, const char *query, size_t qlen) {
+  history_t *history = &s->history;
+  search_index_t *index = &s->index;
+  size_t nfound = 0;
+  uint64_t seq = history->next;
+
+  if (search_sync(index, history) < 0) {
+    perror("malloc");
+    return -1;
+  }
+  while (1) {
+    int rc = search_prev(index, history, query, qlen, seq, &seq);
+    if (rc < 0) {
+      perror("malloc");
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    if (nfound == s->found_cap) {
+      size_t cap = s->found_cap ? s->found_cap * 2 : 64;
+      uint64_t *grown = realloc(s->found, cap * sizeof(*grown));
+      if (grown == NULL) {
+        perror("malloc");
+        return -1;
+      }
+      s->found = grown;
+      s->found_cap = cap;
+    }
+    s->found[nfound++] = seq;
+  }
+  while (nfound > 0) {
+    write_entry(history, s->found[--nfound], true);
+  }
+  fflush(stdout);
+  return 0;
+}
+
+// Reverse incremental search: each key refines the query and shows the
+// newest match; ^R steps to an older one, Enter prints it, ^G/Esc cancels.
+// On a terminal keys are read raw; otherwise the next input line is
+// replayed one byte at a time.
+static int run_isearch(history_t *history, search_index_t *index) {
+  char query[256];
+  size_t qlen = 0;
+  bool found = false;
+  uint64_t match = history->next;
+  struct termios saved;
+  bool tty = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0;
+
+  if (search_sync(index, history) < 0) {
+    perror("malloc");
+    return -1;
+  }
+  if (tty) {
+    struct termios raw = saved;
+    raw.c_lflag &= (tcflag_t) ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+  }
+
+  int rc = 0;
+  while (1) {
+    int c = getc(stdin);
+    uint64_t before;
+    if (c == EOF || c == 7 || c == 27) { // ^G, Esc
+      found = false;
+      break;
+    }
+    if (c == '\n' || c == '\r') {
+      break;
+    }
+    if (c == 18) { // ^R: next older match
+      before = found ? match : history->next;
+    } else if (c == 127 || c == 8) { // Backspace: widen, from the newest
+      qlen -= qlen > 0;
+      before = history->next;
+    } else if (qlen < sizeof(query)) {
+      query[qlen++] = (char)c;
+      before = found ? match + 1 : history->next;
+    } else {
+      continue;
+    }
+
+    uint64_t seq;
+    int r = search_prev(index, history, query, qlen, before, &seq);
+    if (r < 0) {
+      perror("malloc");
+      rc = -1;
+      break;
+    }
+    if (r > 0) {
+      found = true;
+      match = seq;
+    } else if (c != 18) {
+      found = false;
+    }
+    printf(tty ? "\r\033[K" : "");
+    printf("(%sreverse-i-search)`%.*s': ", found ? "" : "failed ",
+           (int)qlen, query);
+    if (found) {
+      write_entry(history, match, false);
+    }
+    if (!tty) {
+      putchar('\n');
+    }
+    fflush(stdout);
+  }
+
+  if (tty) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    putchar('\n');
+  }
+  if (found && rc == 0) {
+    write_entry(history, match, true);
+  }
+  fflush(stdout);
+  return rc;
+}
+
+int main(int argc, char *argv[]) {
+  size_t capacity = HISTORY_SIZE;
+  const char *env = getenv("LAB3_HISTORY_SIZE");
+  const char *path = getenv("LAB3_HISTFILE");
+  const char *shm = getenv("LAB3_SHM");
+  bool intern = false;
+  bool unlink_shm = false;
+  char name[256]; // shm object name, "/" + the -s argument
+  int opt;
+
+  if (env != NULL && parse_size(env, &capacity) < 0) {
+    fprintf(stderr, "invalid LAB3_HISTORY_SIZE: %s\n", env);
+    return 1;
+  }
+  while ((opt = getopt(argc, argv, "n:f:s:du")) != -1) {
+    if (opt == 'f') {
+      path = optarg;
+    } else if (opt == 's') {
+      shm = optarg;
+    } else if (opt == 'd') {
+      intern = true;
+    } else if (opt == 'u') {
+      unlink_shm = true;
+    } else if (opt != 'n' || parse_size(optarg, &capacity) < 0) {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (shm != NULL && shm[0] != '\0') {
+    snprintf(name, sizeof(name), "%s%s", shm[0] == '/' ? "" : "/", shm);
+  } else {
+    shm = NULL;
+  }
+  if (unlink_shm) {
+    if (shm == NULL) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (shmhist_unlink(name) < 0) {
+      perror(name);
+      return 1;
+    }
+    return 0;
+  }
+
+  session_t s = {.histfile = {.log_fd = -1, .idx_fd = -1}};
+  history_t *history = &s.history;
+  char *line = NULL; // For getline (reused, so no allocation per line)
+  size_t len = 0;    // For getline
+  ssize_t nread;     // For getline return value
+  int status = 1; // setup failures only; the loop exits 0 as before
+
+  if ((intern ? history_init_interned(history, capacity)
+              : history_init(history, capacity, HISTORY_BYTES)) < 0) {
+    perror("malloc");
+    return 1;
+  }
+  search_init(&s.index);
+  // Earlier sessions' commands come back from the file
+  if (path != NULL && path[0] != '\0') {
+    s.path = path;
+    if (histfile_open(&s.histfile, path, history) < 0) {
+      perror(path);
+      goto out;
+    }
+  }
+  // Sessions running now share theirs through the shm ring
+  if (shm != NULL) {
+    size_t text = capacity > SHARED_MIN_BYTES / SHARED_BYTES_PER_ENTRY
+                      ? capacity * SHARED_BYTES_PER_ENTRY
+                      : SHARED_MIN_BYTES;
+    if (shmhist_open(&s.shared, name, capacity, text) < 0) {
+      perror(name);
+      goto out;
+    }
+    s.sharing = true;
+    if (pull_shared(&s) < 0) {
+      goto out;
+    }
+  }
+  status = 0;
+
+  while (1) {
+    printf("Enter input: ");
+
+    // Read a line using getline
+    nread = getline(&line, &len, stdin);
+
+    // Check for EOF (Ctrl+C will send EOF)
+    if (nread == -1) {
+      break;
+    }
+
+    // Other sessions' commands typed while this one waited
+    if (s.sharing && pull_shared(&s) < 0) {
+      break;
+    }
+
+    // Searches look at the history before the search line joins it
+    const char *query;
+    size_t qlen;
+    if (is_search(line, (size_t)nread, &query, &qlen) &&
+        run_search(&s, query, qlen) < 0) {
+      break;
+    }
+    if (is_command(line, (size_t)nread, "isearch") &&
+        run_isearch(history, &s.index) < 0) {
+      break;
+    }
+
+    // Add the command to history (newline included, as typed)
+    if (remember(&s, line, (size_t)nread) < 0) {
+      break;
+    }
+
+    // "print" is added to history first, then the history is printed in
+    // one write (after the prompt still sitting in stdout's buffer)
+    size_t k;
+    if (is_print(line, (size_t)nread, &k)) {
+      fflush(stdout);
+      if (history_write_last(history, k, STDOUT_FILENO) < 0) {
+        perror("write");
+        break;
+      }
+    }
+  }
+
+out:
+  // Clean up memory before exiting
+  if (s.sharing) {
+    shmhist_close(&s.shared);
+  }
+  histfile_close(&s.histfile);
+  search_free(&s.index);
+  history_free(history);
+  free(s.found);
+  free(line);
+
+  return status;
+}
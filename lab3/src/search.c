@@ -0,0 +1,273 @@
+// Lab 3 - substring search over history through a trigram index
+#define _GNU_SOURCE // memmem
+#include "search.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+struct search_list {
+  uint32_t trigram;
+  uint32_t *seqs; /* seq - base, ascending; [head, count) are live */
+  uint32_t head;
+  uint32_t count;
+  uint32_t cap;
+  UT_hash_handle hh;
+};
+
+void search_init(search_index_t *s) { memset(s, 0, sizeof(*s)); }
+
+static void drop_lists(search_index_t *s) {
+  search_list_t *list, *tmp;
+  HASH_ITER(hh, s->lists, list, tmp) {
+    HASH_DEL(s->lists, list);
+    free(list->seqs);
+    free(list);
+  }
+}
+
+void search_free(search_index_t *s) {
+  drop_lists(s);
+  free(s->query);
+  free(s->text);
+  search_init(s);
+}
+
+static search_list_t *find_list(const search_index_t *s, uint32_t trigram) {
+  search_list_t *list;
+  HASH_FIND(hh, s->lists, &trigram, sizeof(trigram), list);
+  return list;
+}
+
+/* ---------- posting lists ---------- */
+
+static int post(search_index_t *s, uint32_t trigram, uint32_t rel) {
+  search_list_t *list = find_list(s, trigram);
+  if (list == NULL) {
+    list = calloc(1, sizeof(*list));
+    if (list == NULL) {
+      return -1;
+    }
+    list->trigram = trigram;
+    HASH_ADD(hh, s->lists, trigram, sizeof(list->trigram), list);
+  }
+  // The same trigram twice in one entry is posted once.
+  if (list->count > list->head && list->seqs[list->count - 1] == rel) {
+    return 0;
+  }
+  if (list->count == list->cap) {
+    // Reclaim the evicted front before growing.
+    if (list->head >= list->count / 2 && list->head > 0) {
+      memmove(list->seqs, list->seqs + list->head,
+              (list->count - list->head) * sizeof(*list->seqs));
+      list->count -= list->head;
+      list->head = 0;
+    } else {
+      uint32_t cap = list->cap ? list->cap * 2 : 4;
+      uint32_t *seqs = realloc(list->seqs, cap * sizeof(*seqs));
+      if (seqs == NULL) {
+        return -1;
+      }
+      list->seqs = seqs;
+      list->cap = cap;
+    }
+  }
+  list->seqs[list->count++] = rel;
+  return 0;
+}
+
+static int unpost(search_index_t *s, uint32_t trigram, uint32_t rel) {
+  search_list_t *list = find_list(s, trigram);
+  if (list == NULL || list->head == list->count ||
+      list->seqs[list->head] != rel) {
+    return 0; /* already dropped for an earlier copy in the same entry */
+  }
+  if (++list->head == list->count) {
+    HASH_DEL(s->lists, list);
+    free(list->seqs);
+    free(list);
+  }
+  return 0;
+}
+
+// Call fn for every trigram of entry `seq`, across the wrap if it has one.
+static int for_each_trigram(search_index_t *s, const history_t *h,
+                            uint64_t seq,
+                            int (*fn)(search_index_t *, uint32_t, uint32_t)) {
+  struct iovec piece[2];
+  int n = history_get(h, (size_t)(seq - h->first), piece);
+  uint32_t rel = (uint32_t)(seq - s->base);
+  uint32_t tri = 0;
+  size_t seen = 0;
+  for (int p = 0; p < n; p++) {
+    const unsigned char *b = piece[p].iov_base;
+    for (size_t i = 0; i < piece[p].iov_len; i++) {
+      tri = ((tri << 8) | b[i]) & 0xFFFFFF;
+      if (++seen >= 3 && fn(s, tri, rel) < 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+int search_sync(search_index_t *s, const history_t *h) {
+  // Postings are 32-bit; rebuild relative to the current oldest entry
+  // before a session's sequence numbers outgrow them.
+  if (s->built && h->next - s->base >= UINT32_MAX) {
+    drop_lists(s);
+    s->built = false;
+  }
+  if (!s->built) {
+    s->base = s->first = s->next = h->first;
+    s->built = true;
+  }
+  for (; s->next < h->next; s->next++) {
+    if (for_each_trigram(s, h, s->next, post) < 0) {
+      errno = ENOMEM;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void search_evict_oldest(search_index_t *s, const history_t *h) {
+  if (!s->built || history_count(h) < h->capacity || s->first != h->first) {
+    return;
+  }
+  if (s->first < s->next) {
+    (void)for_each_trigram(s, h, s->first, unpost);
+  } else {
+    s->next++; /* never indexed; keep the range in step */
+  }
+  s->first++;
+}
+
+/* ---------- queries ---------- */
+
+static const char *entry_text(search_index_t *s, const history_t *h,
+                              uint64_t seq, size_t *len) {
+  struct iovec piece[2];
+  int n = history_get(h, (size_t)(seq - h->first), piece);
+  if (n == 1) {
+    *len = piece[0].iov_len;
+    return piece[0].iov_base;
+  }
+  *len = piece[0].iov_len + piece[1].iov_len;
+  if (*len > s->text_cap) {
+    char *text = realloc(s->text, *len);
+    if (text == NULL) {
+      return NULL;
+    }
+    s->text = text;
+    s->text_cap = *len;
+  }
+  memcpy(s->text, piece[0].iov_base, piece[0].iov_len);
+  memcpy(s->text + piece[0].iov_len, piece[1].iov_base, piece[1].iov_len);
+  return s->text;
+}
+
+// 1 if entry `seq` contains the query, 0 if not, -1 on ENOMEM.
+static int matches(search_index_t *s, const history_t *h, uint64_t seq,
+                   const char *q, size_t len) {
+  size_t n;
+  const char *text = entry_text(s, h, seq, &n);
+  if (text == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  return memmem(text, n, q, len) != NULL;
+}
+
+static bool list_has(const search_list_t *list, uint32_t rel) {
+  uint32_t lo = list->head, hi = list->count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (list->seqs[mid] < rel) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo < list->count && list->seqs[lo] == rel;
+}
+
+static int scan_prev(search_index_t *s, const history_t *h, const char *q,
+                     size_t len, uint64_t before, uint64_t *seq) {
+  for (uint64_t i = before; i-- > h->first;) {
+    int m = matches(s, h, i, q, len);
+    if (m != 0) {
+      *seq = i;
+      return m;
+    }
+  }
+  return 0;
+}
+
+int search_prev(search_index_t *s, const history_t *h, const char *q,
+                size_t len, uint64_t before, uint64_t *seq) {
+  if (before > h->next) {
+    before = h->next;
+  }
+  if (len < 3 || !s->built) {
+    return scan_prev(s, h, q, len, before, seq);
+  }
+
+  // Look up every trigram of the query; the rarest one drives the walk.
+  if (len - 2 > s->query_cap) {
+    search_list_t **query = realloc(s->query, (len - 2) * sizeof(*query));
+    if (query == NULL) {
+      errno = ENOMEM;
+      return -1;
+    }
+    s->query = query;
+    s->query_cap = len - 2;
+  }
+  size_t nlists = len - 2;
+  size_t rarest = 0;
+  for (size_t i = 0; i < nlists; i++) {
+    const unsigned char *t = (const unsigned char *)q + i;
+    uint32_t tri = (uint32_t)t[0] << 16 | (uint32_t)t[1] << 8 | t[2];
+    s->query[i] = find_list(s, tri);
+    if (s->query[i] == NULL) {
+      return 0;
+    }
+    search_list_t *a = s->query[i], *b = s->query[rarest];
+    if (a->count - a->head < b->count - b->head) {
+      rarest = i;
+    }
+  }
+
+  const search_list_t *driver = s->query[rarest];
+  uint32_t limit = (uint32_t)(before - s->base);
+  uint32_t lo = driver->head, hi = driver->count;
+  while (lo < hi) { /* first posting >= limit */
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (driver->seqs[mid] < limit) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (uint32_t i = lo; i-- > driver->head;) {
+    uint32_t rel = driver->seqs[i];
+    if (s->base + rel < h->first) {
+      break; /* evicted without search_evict_oldest() */
+    }
+    bool all = true;
+    for (size_t k = 0; k < nlists && all; k++) {
+      all = k == rarest || list_has(s->query[k], rel);
+    }
+    if (!all) {
+      continue;
+    }
+    // Every trigram is present, but maybe not in this order.
+    int m = matches(s, h, s->base + rel, q, len);
+    if (m != 0) {
+      *seq = s->base + rel;
+      return m;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+// Lab 3 - trigram search vs. linear scan over a large history
+//
+// Fills a history with generated shell-like lines, builds the trigram
+// index, then times each query (and each keystroke of an incremental
+// search) through the index and through a plain scan of every entry.
+// Finally it keeps adding lines at full capacity to show the cost of
+// maintaining the index while entries are evicted. CSV on stdout.
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "history.h"
+#include "search.h"
+
+#define DEFAULT_ENTRIES 1000000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// A command, a few arguments from a small vocabulary, and now and then a
+// random token so that rare queries exist.
+static size_t gen_line(char *buf) {
+  static const char *const cmds[] = {"git", "ls", "make", "cd", "grep",
+                                     "vim", "cat", "ssh", "docker", "python3"};
+  static const char *const args[] = {
+      "status", "commit", "-la",   "src",  "build",   "main.c", "TODO",
+      "-r",     "push",   "../..", "test", "--force", "deploy", "README.md"};
+  size_t n = (size_t)sprintf(buf, "%s", cmds[rng() % 10]);
+  for (size_t k = rng() % 4; k > 0; k--) {
+    n += (size_t)sprintf(buf + n, " %s", args[rng() % 14]);
+  }
+  if (rng() % 8 == 0) {
+    n += (size_t)sprintf(buf + n, " x%06u", (unsigned)(rng() % 1000000));
+  }
+  buf[n++] = '\n';
+  return n;
+}
+
+// Average microseconds per search_prev() call from the newest entry.
+static double time_query(search_index_t *s, const history_t *h,
+                         const char *q, size_t len, int reps, int *hit) {
+  uint64_t seq;
+  double t0 = now_seconds();
+  for (int r = 0; r < reps; r++) {
+    *hit = search_prev(s, h, q, len, h->next, &seq);
+  }
+  return (now_seconds() - t0) * 1e6 / reps;
+}
+
+int main(int argc, char *argv[]) {
+  size_t entries = DEFAULT_ENTRIES;
+  if (argc > 1) {
+    entries = strtoul(argv[1], NULL, 10);
+  }
+  if (entries == 0) {
+    fprintf(stderr, "Usage: %s [entries]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  history_t h;
+  search_index_t indexed, scan;
+  char line[128];
+  if (history_init(&h, entries, entries * 32) < 0) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  search_init(&indexed);
+  search_init(&scan); /* never synced: every query is a scan */
+  for (size_t i = 0; i < entries; i++) {
+    history_add(&h, line, gen_line(line));
+  }
+
+  printf("bench,query,entries,hit,indexed_us,scan_us\n");
+  double t0 = now_seconds();
+  if (search_sync(&indexed, &h) < 0) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  printf("build,,%zu,,%.0f,\n", entries, (now_seconds() - t0) * 1e6);
+
+  // A token from the middle of the history, a common word, and text that
+  // never occurs.
+  char rare[16] = "x000000";
+  for (uint64_t i = h.first + entries / 2; i < h.next; i++) {
+    struct iovec piece[2];
+    history_get(&h, (size_t)(i - h.first), piece);
+    const char *x = memchr(piece[0].iov_base, 'x', piece[0].iov_len);
+    if (x != NULL && (size_t)(x - (char *)piece[0].iov_base) + 7 <=
+                         piece[0].iov_len) {
+      memcpy(rare, x, 7);
+      break;
+    }
+  }
+  const char *queries[] = {rare, "commit --force", "git", "docker deploy",
+                           "zzqy"};
+  for (size_t i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+    size_t len = strlen(queries[i]);
+    int hit1, hit2;
+    double fast = time_query(&indexed, &h, queries[i], len, 100, &hit1);
+    double slow = time_query(&scan, &h, queries[i], len, 3, &hit2);
+    if (hit1 != hit2) {
+      fprintf(stderr, "mismatch on %s\n", queries[i]);
+      return EXIT_FAILURE;
+    }
+    printf("query,%s,%zu,%d,%.2f,%.2f\n", queries[i], entries, hit1, fast,
+           slow);
+  }
+
+  // Typing the rare token one key at a time.
+  for (size_t len = 1; len <= strlen(rare); len++) {
+    int hit1, hit2;
+    double fast = time_query(&indexed, &h, rare, len, 100, &hit1);
+    double slow = time_query(&scan, &h, rare, len, 3, &hit2);
+    printf("keystroke,%.*s,%zu,%d,%.2f,%.2f\n", (int)len, rare, entries, hit1,
+           fast, slow);
+  }
+
+  // Steady state: every add evicts the oldest entry from ring and index.
+  size_t adds = entries / 10;
+  t0 = now_seconds();
+  for (size_t i = 0; i < adds; i++) {
+    search_evict_oldest(&indexed, &h);
+    history_add(&h, line, gen_line(line));
+    if (search_sync(&indexed, &h) < 0) {
+      perror("malloc");
+      return EXIT_FAILURE;
+    }
+  }
+  printf("add_evict,,%zu,,%.3f,\n", entries,
+         (now_seconds() - t0) * 1e6 / (double)adds);
+
+  search_free(&indexed);
+  search_free(&scan);
+  history_free(&h);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,307 @@
+// Lab 3 - history shared between sessions through POSIX shared memory
+#define _DEFAULT_SOURCE
+#include "shmhist.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHMHIST_MAGIC 0x6c61623368697374ULL /* "lab3hist" */
+#define SLOTS_OFFSET 64 /* header padded to a cache line */
+#define ATTACH_TRIES 1000 /* 1 ms apart, while the creator sets up */
+#define STALL_NS 2000000000ULL /* a writer that has not published this
+                                  long after others is taken for dead */
+#define READER_SPINS 100 /* yields before leaving an overtaken entry to
+                            a later pull */
+
+static size_t layout_size(uint64_t slots, uint64_t text_size) {
+  return SLOTS_OFFSET + slots * sizeof(shmhist_slot_t) + text_size;
+}
+
+static void pause_ms(void) {
+  struct timespec ts = {0, 1000000};
+  nanosleep(&ts, NULL);
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ---------- attach ---------- */
+
+// Wait until the creator has sized the object and published the header.
+static int attach(shmhist_t *sh, int fd) {
+  struct stat st;
+  for (int tries = 0;; tries++) {
+    if (fstat(fd, &st) < 0) {
+      return -1;
+    }
+    if (st.st_size > 0) {
+      break;
+    }
+    if (tries == ATTACH_TRIES) {
+      errno = ETIMEDOUT;
+      return -1;
+    }
+    pause_ms();
+  }
+  void *map =
+      mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  sh->hdr = map;
+  sh->map_size = (size_t)st.st_size;
+  for (int tries = 0;
+       atomic_load_explicit(&sh->hdr->magic, memory_order_acquire) !=
+       SHMHIST_MAGIC;
+       tries++) {
+    if (tries == ATTACH_TRIES) {
+      errno = ETIMEDOUT;
+      return -1;
+    }
+    pause_ms();
+  }
+  if (sh->hdr->slots == 0 ||
+      layout_size(sh->hdr->slots, sh->hdr->text_size) != sh->map_size) {
+    errno = EINVAL; // not a history, or from an incompatible build
+    return -1;
+  }
+  return 0;
+}
+
+int shmhist_open(shmhist_t *sh, const char *name, size_t slots,
+                 size_t text_size) {
+  memset(sh, 0, sizeof(*sh));
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  int creator = fd >= 0;
+  if (!creator && errno == EEXIST) {
+    fd = shm_open(name, O_RDWR, 0);
+  }
+  if (fd < 0) {
+    return -1;
+  }
+
+  int rc;
+  if (creator) {
+    // A fresh object reads as zeros: no entries, every slot unwritten
+    size_t size = layout_size(slots, text_size);
+    void *map = MAP_FAILED;
+    if (slots == 0 || text_size < 4) {
+      errno = EINVAL;
+    } else if (ftruncate(fd, (off_t)size) == 0) {
+      map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    rc = map == MAP_FAILED ? -1 : 0;
+    if (rc == 0) {
+      sh->hdr = map;
+      sh->map_size = size;
+      sh->hdr->slots = slots;
+      sh->hdr->text_size = text_size;
+      atomic_store_explicit(&sh->hdr->magic, SHMHIST_MAGIC,
+                            memory_order_release);
+    } else {
+      int saved = errno;
+      shm_unlink(name);
+      errno = saved;
+    }
+  } else {
+    rc = attach(sh, fd);
+  }
+  int saved = errno;
+  close(fd);
+  if (rc < 0) {
+    shmhist_close(sh);
+    errno = saved;
+    return -1;
+  }
+
+  sh->slot = (shmhist_slot_t *)((char *)sh->hdr + SLOTS_OFFSET);
+  sh->text = (char *)(sh->slot + sh->hdr->slots);
+  uint64_t next = atomic_load_explicit(&sh->hdr->next, memory_order_acquire);
+  sh->seen = next > sh->hdr->slots ? next - sh->hdr->slots : 0;
+  return 0;
+}
+
+int shmhist_unlink(const char *name) {
+  return shm_unlink(name);
+}
+
+void shmhist_close(shmhist_t *sh) {
+  if (sh->hdr != NULL) {
+    munmap(sh->hdr, sh->map_size);
+  }
+  free(sh->buf);
+  memset(sh, 0, sizeof(*sh));
+}
+
+/* ---------- append ---------- */
+
+int shmhist_append(shmhist_t *sh, const char *line, size_t len) {
+  shmhist_header_t *hdr = sh->hdr;
+  if (len > hdr->text_size / 4) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+
+  // Reserve an index and a run of text; nobody else will get either
+  uint64_t i = atomic_fetch_add_explicit(&hdr->next, 1, memory_order_relaxed);
+  uint64_t start =
+      atomic_fetch_add_explicit(&hdr->bytes, len, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  // The text goes in before the slot is claimed, keeping the claimed
+  // window down to two stores
+  size_t at = (size_t)(start % hdr->text_size);
+  size_t first = len < hdr->text_size - at ? len : hdr->text_size - at;
+  memcpy(sh->text + at, line, first);
+  memcpy(sh->text, line + first, len - first);
+
+  shmhist_slot_t *s = &sh->slot[i % hdr->slots];
+  uint64_t cur = atomic_load_explicit(&s->seq, memory_order_relaxed);
+  uint64_t since = 0;
+  while (1) {
+    if (cur >= 2 * i + 1) {
+      return 0; // a writer one lap ahead owns the slot; entry i is gone
+    }
+    if (cur % 2 == 1) {
+      // The previous lap's writer is mid-claim; take the slot only once
+      // it has held it long enough to have died, not just been preempted
+      uint64_t now = now_ns();
+      if (since == 0) {
+        since = now;
+      }
+      if (now - since < STALL_NS) {
+        sched_yield();
+        cur = atomic_load_explicit(&s->seq, memory_order_relaxed);
+        continue;
+      }
+    }
+    if (atomic_compare_exchange_weak_explicit(&s->seq, &cur, 2 * i + 1,
+                                              memory_order_relaxed,
+                                              memory_order_relaxed)) {
+      break;
+    }
+  }
+  atomic_thread_fence(memory_order_release);
+  s->start = start;
+  s->len = len;
+  // Publish unless a newer writer took the slot while this one stalled
+  uint64_t claimed = 2 * i + 1;
+  atomic_compare_exchange_strong_explicit(&s->seq, &claimed, 2 * i + 2,
+                                          memory_order_release,
+                                          memory_order_relaxed);
+  return 0;
+}
+
+/* ---------- pull ---------- */
+
+// Whether an entry after `i` (and before `next`) is already published.
+static int overtaken(const shmhist_t *sh, uint64_t i, uint64_t next) {
+  for (uint64_t j = i + 1; j < next && j - i < sh->hdr->slots; j++) {
+    uint64_t seq = atomic_load_explicit(&sh->slot[j % sh->hdr->slots].seq,
+                                        memory_order_relaxed);
+    if (seq >= 2 * j + 2) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Entry i is reserved but not published. While it is the newest, wait
+// for it (return 0). Once a newer entry is published, yield to its writer
+// briefly, then leave it to a later pull; only when it has stayed
+// unpublished for STALL_NS since this session first found it overtaken is
+// its writer taken for dead and the entry skipped, so a writer that died
+// between reserving and publishing holds sessions up for seconds, not
+// until writers lap the ring. Returns 1 once entry i is published, -1 to
+// skip it.
+static int wait_published(shmhist_t *sh, uint64_t i, uint64_t next) {
+  shmhist_slot_t *s = &sh->slot[i % sh->hdr->slots];
+  if (!overtaken(sh, i, next)) {
+    return 0;
+  }
+  for (int spins = 0; spins < READER_SPINS; spins++) {
+    sched_yield();
+    if (atomic_load_explicit(&s->seq, memory_order_acquire) >= 2 * i + 2) {
+      return 1;
+    }
+  }
+  uint64_t now = now_ns();
+  if (sh->stall_since == 0 || sh->stall_index != i) {
+    sh->stall_index = i;
+    sh->stall_since = now;
+  }
+  return now - sh->stall_since < STALL_NS ? 0 : -1;
+}
+
+int shmhist_next(shmhist_t *sh, const char **line, size_t *len) {
+  shmhist_header_t *hdr = sh->hdr;
+  while (1) {
+    uint64_t next = atomic_load_explicit(&hdr->next, memory_order_acquire);
+    if (sh->seen >= next) {
+      return 0;
+    }
+    if (next - sh->seen > hdr->slots) {
+      sh->seen = next - hdr->slots; // writers lapped this session
+    }
+
+    shmhist_slot_t *s = &sh->slot[sh->seen % hdr->slots];
+    uint64_t want = 2 * sh->seen + 2;
+    uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    if (seq < want) {
+      int rc = wait_published(sh, sh->seen, next);
+      if (rc == 0) {
+        return 0; // reserved but not published yet
+      }
+      if (rc < 0) {
+        sh->seen++; // its writer died
+        continue;
+      }
+      seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    }
+    uint64_t start = s->start;
+    uint64_t n = s->len;
+    if (seq > want || n > hdr->text_size / 4) {
+      sh->seen++; // overwritten already, or read mid-write
+      continue;
+    }
+
+    if (n > sh->buf_cap) {
+      size_t cap = sh->buf_cap ? sh->buf_cap : 256;
+      while (cap < n) {
+        cap *= 2;
+      }
+      char *grown = realloc(sh->buf, cap);
+      if (grown == NULL) {
+        return -1;
+      }
+      sh->buf = grown;
+      sh->buf_cap = cap;
+    }
+    size_t at = (size_t)(start % hdr->text_size);
+    size_t first = n < hdr->text_size - at ? n : hdr->text_size - at;
+    memcpy(sh->buf, sh->text + at, first);
+    memcpy(sh->buf + first, sh->text, n - first);
+
+    // Keep the copy only if neither the slot nor its text was reused
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t again = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    uint64_t bytes = atomic_load_explicit(&hdr->bytes, memory_order_relaxed);
+    sh->seen++;
+    if (again == want && bytes - start <= hdr->text_size) {
+      *line = sh->buf;
+      *len = (size_t)n;
+      return 1;
+    }
+  }
+}
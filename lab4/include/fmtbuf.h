@@ -0,0 +1,57 @@
+// Lab 4 - heap-free buffered output
+//
+// A fixed buffer inside the struct (put it on the stack) and hand-rolled
+// integer, hex and pointer formatting, flushed with write(2) when full or
+// on request. Nothing here allocates or takes a lock, so it is safe inside
+// the allocator and in signal handlers; a flush keeps errno as it was.
+#ifndef LAB4_FMTBUF_H
+#define LAB4_FMTBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FMTBUF_SIZE 4096
+
+typedef struct {
+  int fd;
+  size_t used;
+  char data[FMTBUF_SIZE];
+} fmtbuf_t;
+
+static inline void fmtbuf_init(fmtbuf_t *fb, int fd) {
+  fb->fd = fd;
+  fb->used = 0;
+}
+
+/* Write everything queued. Returns 0, or -1 if write(2) failed (the
+   queued bytes are dropped either way). */
+int fmtbuf_flush(fmtbuf_t *fb);
+
+/* Queue bytes, flushing whenever the buffer fills. Returns 0 or -1. */
+int fmtbuf_write(fmtbuf_t *fb, const void *data, size_t len);
+int fmtbuf_str(fmtbuf_t *fb, const char *s);
+
+static inline int fmtbuf_putc(fmtbuf_t *fb, char c) {
+  if (fb->used == FMTBUF_SIZE && fmtbuf_flush(fb) < 0) {
+    return -1;
+  }
+  fb->data[fb->used++] = c;
+  return 0;
+}
+
+int fmtbuf_u64(fmtbuf_t *fb, uint64_t v);
+int fmtbuf_i64(fmtbuf_t *fb, int64_t v);
+/* Lower-case hex without a prefix. */
+int fmtbuf_hex(fmtbuf_t *fb, uint64_t v);
+/* As printf's %p: 0x-prefixed hex, or "(nil)". */
+int fmtbuf_ptr(fmtbuf_t *fb, const void *p);
+
+/* A printf subset: %%, %c, %s, %d, %i, %u, %x and %p, with the hh, h, l,
+   ll, z and j length modifiers (so PRIu64 and PRIx64 work), the - and 0
+   flags and a field width. Any other conversion or flag, or a precision,
+   prints "%?" and ends the call with -1 and errno = EINVAL, since its
+   argument could not be skipped. Returns 0 or -1. */
+int fmtbuf_printf(fmtbuf_t *fb, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#endif
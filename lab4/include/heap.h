@@ -0,0 +1,124 @@
+// Lab 4 - general-purpose allocator on sbrk
+//
+// Every block starts with the lab's header_t: `size` is the whole block in
+// bytes (a multiple of 16, header included) with two flag bits in the low
+// end, and the payload follows the header, so payloads are 16-byte aligned.
+// Free blocks are kept in segregated lists (one per 16-byte size up to
+// 1 KiB, then four per power of two), linked through `next` and a back
+// pointer at the start of the payload, and end in a copy of their size so
+// that a block being freed can merge with the free block before it.
+//
+// The heap grows with sbrk. Each contiguous stretch of break ends in an
+// empty "epilogue" header marked in use; when another sbrk user (stdio,
+// glibc malloc) moved the break in between, a new stretch starts and the
+// old epilogue's `next` points to it. The heap itself is under one mutex.
+//
+// In front of it, each thread caches blocks of up to 1 KiB per 16-byte
+// class, refilled and flushed in batches under a single lock acquisition.
+// An allocated block's `next` names the cache it came from (NULL for
+// blocks straight from the heap). Freeing it on its owner thread pushes it
+// back on that cache; any other thread pushes it on the owner's lock-free
+// remote list, which the owner takes in one exchange when a class runs
+// dry. A thread's cache is flushed when the thread exits.
+//
+// Requests at or above the mmap threshold (128 KiB unless changed) skip
+// the heap: each gets its own mapping, flagged HEAP_MMAPPED, which is
+// unmapped on free, so a long-lived large block never pins the break.
+// Mappings of 2 MiB or more, and the heap from 2 MiB on, are aligned to
+// and advised for transparent huge pages.
+//
+// Memory goes back to the system while running: when a free leaves more
+// than 1 MiB free at the top of the break, the break is lowered to keep
+// 128 KiB (the gap between the two is the hysteresis that stops a
+// grow/shrink cycle per call). heap_trim() does the same down to a given
+// pad and also drops the pages inside large free blocks lower down.
+//
+// For finding out where memory went, heap_stats() counts the blocks the
+// program holds by size class without adding work to malloc and free: the
+// heap counts what it hands out under its lock, each thread cache already
+// counts what it holds, and frees onto a remote list are counted there.
+// The counters are read without locks, so with other threads running the
+// figures may be a moment out of date.
+#ifndef LAB4_HEAP_H
+#define LAB4_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct header {
+  uint64_t size;
+  struct header *next;
+};
+typedef struct header header_t;
+
+#define HEAP_ALIGN 16
+#define HEAP_USED 1u      /* this block is allocated */
+#define HEAP_PREV_USED 2u /* the block just before it is allocated */
+#define HEAP_MMAPPED 4u   /* a mapping of its own, not on the heap */
+#define HEAP_FLAGS (HEAP_ALIGN - 1)
+
+/* Block size without the flag bits. The heap flips HEAP_PREV_USED on an
+   allocated block's header while its owner may be reading the size, so
+   the word is read atomically (a plain load on every target we build). */
+static inline size_t block_size(const header_t *h) {
+  uint64_t size = __atomic_load_n(&h->size, __ATOMIC_RELAXED);
+  return (size_t)(size & ~(uint64_t)HEAP_FLAGS);
+}
+
+/* Header of an allocated payload. */
+static inline header_t *block_of(void *p) {
+  return (header_t *)p - 1;
+}
+
+/* The usual contracts of malloc, free, realloc and calloc; failures
+   return NULL with errno = ENOMEM. my_realloc(p, 0) frees p and returns
+   NULL. Growing tries to extend the block in place first. */
+void *my_malloc(size_t size);
+void my_free(void *p);
+void *my_realloc(void *p, size_t size);
+void *my_calloc(size_t n, size_t size);
+
+/* Bytes usable at p (at least what was asked for). */
+size_t my_usable_size(void *p);
+
+/* Flush this thread's cache, lower the break to leave at most `pad`
+   free bytes at the top, and madvise(MADV_DONTNEED) the interior pages of
+   free blocks of 64 KiB or more. Returns the bytes given back. */
+size_t heap_trim(size_t pad);
+
+/* Serve requests of `bytes` or more with their own mapping from now on;
+   SIZE_MAX (or anything above the largest request) turns that off. */
+void heap_set_mmap_threshold(size_t bytes);
+
+#define HEAP_STAT_CLASSES 20 /* block sizes [32 << k, 64 << k); the last open */
+
+typedef struct {
+  size_t heap_bytes;   /* taken from sbrk */
+  size_t heap_free;    /* on the heap's free lists (not thread caches) */
+  size_t mmap_bytes;   /* mapped for large blocks */
+  size_t mmap_blocks;
+  size_t in_use;       /* in blocks the program holds, headers included */
+  size_t cached;       /* the rest of heap_bytes: thread caches, epilogues */
+  size_t peak_bytes;   /* most of heap_bytes + mmap_bytes at any time */
+  size_t largest_free; /* biggest block on the free lists */
+  double fragmentation; /* 1 - largest_free / heap_free, 0 with none free */
+  size_t blocks[HEAP_STAT_CLASSES]; /* held by the program, by size class */
+} heap_stats_t;
+
+/* Snapshot of how much memory each path holds and how it is split up. */
+void heap_stats(heap_stats_t *st);
+
+/* Write heap_stats() as text to fd, without allocating. */
+void heap_dump_stats(int fd);
+
+/* Dump the stats to stderr whenever `signo` arrives (e.g. SIGUSR1). The
+   handler only tries the heap lock: if the signal lands while the heap is
+   busy, the figures that need the lock are left out. Returns 0, or -1
+   with errno set. */
+int heap_stats_on_signal(int signo);
+
+/* Walk every block and free list and check that they agree. Returns 0,
+   or -1 after printing the first inconsistency to stderr. */
+int heap_check(void);
+
+#endif
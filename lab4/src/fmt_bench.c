@@ -0,0 +1,231 @@
+// Lab 4 - cost of lab4's output: snprintf + write per value vs fmtbuf
+//
+// Both implementations print what lab4 prints (two block addresses, their
+// header fields, the 224 payload bytes one per line and the heap stats) to
+// a memfd, -n times each. "print_out" is the lab's original helper: one
+// snprintf into a stack buffer and one write(2) per value. "fmtbuf" queues
+// everything in a 4 KiB buffer on the stack and writes it when full or at
+// the end. Before timing, one dump from each is read back and compared, so
+// the two must produce the same bytes. The executable is linked with
+// --wrap=write, so every write(2) this program and the heap library make is
+// counted; each CSV row gives writes and nanoseconds per dump.
+#define _GNU_SOURCE // memfd_create
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fmtbuf.h"
+#include "heap.h"
+
+#define DEFAULT_REPS 20000
+#define BUF_SIZE 256
+#define PAYLOAD 112 /* as in lab4: 128-byte blocks minus the header */
+
+/* ---------- write counter ---------- */
+
+// volatile: the compiler assumes write() never touches our globals.
+static volatile size_t writes;
+
+ssize_t __real_write(int fd, const void *buf, size_t n);
+
+ssize_t __wrap_write(int fd, const void *buf, size_t n) {
+  writes++;
+  return __real_write(fd, buf, n);
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* ---------- what lab4 prints ---------- */
+
+typedef struct {
+  header_t *first, *second;
+  uint8_t *first_data, *second_data;
+  heap_stats_t st;
+} dump_t;
+
+typedef struct {
+  void (*ptr)(void *ctx, const char *fmt, const void *p);
+  void (*u64)(void *ctx, const char *fmt, uint64_t v);
+} printer_t;
+
+static void dump(const dump_t *d, const printer_t *pr, void *ctx) {
+  pr->ptr(ctx, "first block:       %p\n", (void *)d->first);
+  pr->ptr(ctx, "second block:      %p\n", (void *)d->second);
+  pr->u64(ctx, "first block size:  %" PRIu64 "\n", block_size(d->first));
+  pr->ptr(ctx, "first block next:  %p\n", (void *)d->first->next);
+  pr->u64(ctx, "second block size: %" PRIu64 "\n", block_size(d->second));
+  pr->ptr(ctx, "second block next: %p\n", (void *)d->second->next);
+  for (size_t i = 0; i < PAYLOAD; ++i) {
+    pr->u64(ctx, "%" PRIu64 "\n", (uint64_t)d->first_data[i]);
+  }
+  for (size_t i = 0; i < PAYLOAD; ++i) {
+    pr->u64(ctx, "%" PRIu64 "\n", (uint64_t)d->second_data[i]);
+  }
+  pr->u64(ctx, "heap bytes:        %" PRIu64 "\n", d->st.heap_bytes);
+  pr->u64(ctx, "heap free bytes:   %" PRIu64 "\n", d->st.heap_free);
+  pr->u64(ctx, "mmap bytes:        %" PRIu64 "\n", d->st.mmap_bytes);
+  pr->u64(ctx, "mmap blocks:       %" PRIu64 "\n", d->st.mmap_blocks);
+}
+
+/* ---------- the original print_out ---------- */
+
+// The lab's helper, with its pointer/integer ternary split into two calls
+// so that each value reaches snprintf with the type the format expects.
+static void print_out(int fd, const char *format, void *data,
+                      size_t data_size) {
+  char buf[BUF_SIZE];
+  int len = data_size == sizeof(uint64_t)
+                ? snprintf(buf, BUF_SIZE, format, *(uint64_t *)data)
+                : snprintf(buf, BUF_SIZE, format, *(void **)data);
+  if (len > 0) {
+    (void)write(fd, buf, (size_t)len);
+  }
+}
+
+static void legacy_ptr(void *ctx, const char *fmt, const void *p) {
+  void *q = (void *)p;
+  print_out(*(int *)ctx, fmt, &q, 0);
+}
+
+static void legacy_u64(void *ctx, const char *fmt, uint64_t v) {
+  print_out(*(int *)ctx, fmt, &v, sizeof(uint64_t));
+}
+
+static const printer_t legacy = {legacy_ptr, legacy_u64};
+
+/* ---------- fmtbuf ---------- */
+
+static void fmt_ptr(void *ctx, const char *fmt, const void *p) {
+  fmtbuf_printf(ctx, fmt, p);
+}
+
+static void fmt_u64(void *ctx, const char *fmt, uint64_t v) {
+  fmtbuf_printf(ctx, fmt, v);
+}
+
+static const printer_t buffered = {fmt_ptr, fmt_u64};
+
+// One dump through `impl` to the start of fd; returns the bytes written.
+static off_t run_once(int fd, const char *impl, const dump_t *d) {
+  lseek(fd, 0, SEEK_SET);
+  if (strcmp(impl, "print_out") == 0) {
+    dump(d, &legacy, &fd);
+  } else {
+    fmtbuf_t out;
+    fmtbuf_init(&out, fd);
+    dump(d, &buffered, &out);
+    fmtbuf_flush(&out);
+  }
+  return lseek(fd, 0, SEEK_CUR);
+}
+
+static const char *const impls[] = {"print_out", "fmtbuf"};
+
+/* ---------- driver ---------- */
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-n reps] [-l label] [-o results.csv]\n"
+          "  -n  dumps per implementation (default %d)\n"
+          "  -l  build label written to every row (default \"dev\")\n"
+          "  -o  append CSV rows to this file instead of stdout\n",
+          prog, DEFAULT_REPS);
+}
+
+int main(int argc, char **argv) {
+  size_t reps = DEFAULT_REPS;
+  const char *label = "dev";
+  const char *csv_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:l:o:")) != -1) {
+    switch (opt) {
+    case 'n':
+      reps = strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      label = optarg;
+      break;
+    case 'o':
+      csv_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (reps == 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *csv = stdout;
+  if (csv_path != NULL) {
+    csv = fopen(csv_path, "a");
+    if (csv == NULL) {
+      perror(csv_path);
+      return EXIT_FAILURE;
+    }
+  }
+  int fd = memfd_create("fmt_bench", 0);
+  if (fd < 0) {
+    perror("memfd_create");
+    return EXIT_FAILURE;
+  }
+
+  dump_t d;
+  d.first_data = my_malloc(PAYLOAD);
+  d.second_data = my_malloc(PAYLOAD);
+  if (d.first_data == NULL || d.second_data == NULL) {
+    perror("my_malloc");
+    return EXIT_FAILURE;
+  }
+  d.first = block_of(d.first_data);
+  d.second = block_of(d.second_data);
+  memset(d.first_data, 0x00, PAYLOAD);
+  memset(d.second_data, 0x01, PAYLOAD);
+  heap_stats(&d.st);
+
+  // Same bytes from both, or the timing means nothing.
+  static char want[16384], got[16384];
+  off_t n = run_once(fd, impls[0], &d);
+  if (n <= 0 || (size_t)n > sizeof(want) ||
+      pread(fd, want, (size_t)n, 0) != n) {
+    fprintf(stderr, "print_out: could not read back its dump\n");
+    return EXIT_FAILURE;
+  }
+  if (run_once(fd, impls[1], &d) != n || pread(fd, got, (size_t)n, 0) != n ||
+      memcmp(want, got, (size_t)n) != 0) {
+    fprintf(stderr, "fmtbuf: output differs from print_out\n");
+    return EXIT_FAILURE;
+  }
+
+  fprintf(csv, "label,impl,reps,bytes_per_dump,writes_per_dump,ns_per_dump\n");
+  for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+    size_t before = writes;
+    double start = now_seconds();
+    for (size_t r = 0; r < reps; r++) {
+      run_once(fd, impls[i], &d);
+    }
+    double seconds = now_seconds() - start;
+    fprintf(csv, "%s,%s,%zu,%lld,%.1f,%.1f\n", label, impls[i], reps,
+            (long long)n, (double)(writes - before) / (double)reps,
+            seconds * 1e9 / (double)reps);
+  }
+
+  my_free(d.second_data);
+  my_free(d.first_data);
+  close(fd);
+  if (csv != stdout) {
+    fclose(csv);
+  }
+  return 0;
+}
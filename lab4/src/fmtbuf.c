@@ -0,0 +1,221 @@
+// Lab 4 - heap-free buffered output
+#include "fmtbuf.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+int fmtbuf_flush(fmtbuf_t *fb) {
+  int saved = errno;
+  int rc = 0;
+  const char *p = fb->data;
+  size_t left = fb->used;
+  while (left > 0) {
+    ssize_t n = write(fb->fd, p, left);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      rc = -1;
+      break;
+    }
+    p += n;
+    left -= (size_t)n;
+  }
+  fb->used = 0;
+  errno = saved;
+  return rc;
+}
+
+int fmtbuf_write(fmtbuf_t *fb, const void *data, size_t len) {
+  const char *p = data;
+  while (len > 0) {
+    if (fb->used == FMTBUF_SIZE && fmtbuf_flush(fb) < 0) {
+      return -1;
+    }
+    size_t n = FMTBUF_SIZE - fb->used;
+    n = n < len ? n : len;
+    memcpy(fb->data + fb->used, p, n);
+    fb->used += n;
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int fmtbuf_str(fmtbuf_t *fb, const char *s) {
+  return fmtbuf_write(fb, s, strlen(s));
+}
+
+/* ---------- numbers ---------- */
+
+// Digits of v in `base`, zero-padded to `width` (at most 64), written
+// backwards ending at `end`. Returns the first digit.
+static char *to_digits(char *end, uint64_t v, unsigned base, int width) {
+  static const char digits[] = "0123456789abcdef";
+  char *p = end;
+  do {
+    *--p = digits[v % base];
+    v /= base;
+  } while (v != 0);
+  while (end - p < width && end - p < 64) {
+    *--p = '0';
+  }
+  return p;
+}
+
+// Write `len` bytes space-padded to `width`: on the left, or on the right
+// if `pad` is '-'.
+static int put_padded(fmtbuf_t *fb, const char *s, size_t len, int width,
+                      char pad) {
+  size_t fill = width > 0 && (size_t)width > len ? (size_t)width - len : 0;
+  for (; pad != '-' && fill > 0; fill--) {
+    if (fmtbuf_putc(fb, ' ') < 0) {
+      return -1;
+    }
+  }
+  if (fmtbuf_write(fb, s, len) < 0) {
+    return -1;
+  }
+  for (; fill > 0; fill--) {
+    if (fmtbuf_putc(fb, ' ') < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Format like printf's %[-|0][width]d/u/x: the sign goes before zero
+// padding (-0042) and after space padding (  -42, -42  ).
+static int put_number(fmtbuf_t *fb, uint64_t v, bool negative, unsigned base,
+                      int width, char pad) {
+  char buf[80];
+  char *end = buf + sizeof(buf);
+  char *p = to_digits(end, v, base, pad == '0' ? width - negative : 0);
+  if (negative) {
+    *--p = '-';
+  }
+  return put_padded(fb, p, (size_t)(end - p), width, pad);
+}
+
+int fmtbuf_u64(fmtbuf_t *fb, uint64_t v) {
+  return put_number(fb, v, false, 10, 0, ' ');
+}
+
+int fmtbuf_i64(fmtbuf_t *fb, int64_t v) {
+  uint64_t mag = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+  return put_number(fb, mag, v < 0, 10, 0, ' ');
+}
+
+int fmtbuf_hex(fmtbuf_t *fb, uint64_t v) {
+  return put_number(fb, v, false, 16, 0, ' ');
+}
+
+// %p, space-padded to `width`.
+static int put_ptr(fmtbuf_t *fb, const void *ptr, int width, char pad) {
+  if (ptr == NULL) {
+    return put_padded(fb, "(nil)", 5, width, pad);
+  }
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *p = to_digits(end, (uint64_t)(uintptr_t)ptr, 16, 0);
+  *--p = 'x';
+  *--p = '0';
+  return put_padded(fb, p, (size_t)(end - p), width, pad);
+}
+
+int fmtbuf_ptr(fmtbuf_t *fb, const void *p) {
+  return put_ptr(fb, p, 0, ' ');
+}
+
+/* ---------- printf subset ---------- */
+
+int fmtbuf_printf(fmtbuf_t *fb, const char *fmt, ...) {
+  va_list ap;
+  int rc = 0;
+  va_start(ap, fmt);
+  while (rc == 0 && *fmt != '\0') {
+    const char *pct = strchr(fmt, '%');
+    if (pct == NULL) {
+      rc = fmtbuf_str(fb, fmt);
+      break;
+    }
+    if (fmtbuf_write(fb, fmt, (size_t)(pct - fmt)) < 0) {
+      rc = -1;
+      break;
+    }
+    const char *spec = pct + 1;
+
+    char pad = ' '; // '0', or '-' to left-justify (which wins, as in printf)
+    int width = 0;
+    int longs = 0;  // l's; z and j (64-bit here) count as ll
+    int shorts = 0; // h's
+    for (; *spec == '-' || *spec == '0'; spec++) {
+      pad = *spec == '-' || pad == '-' ? '-' : '0';
+    }
+    while (*spec >= '0' && *spec <= '9') {
+      width = width * 10 + (*spec++ - '0');
+    }
+    while (*spec == 'h' || *spec == 'l' || *spec == 'z' || *spec == 'j') {
+      shorts += *spec == 'h';
+      longs += *spec == 'l' ? 1 : *spec == 'h' ? 0 : 2;
+      spec++;
+    }
+
+    switch (*spec) {
+    case '%':
+      rc = fmtbuf_putc(fb, '%');
+      break;
+    case 'c': {
+      char c = (char)va_arg(ap, int);
+      rc = put_padded(fb, &c, 1, width, pad);
+      break;
+    }
+    case 's': {
+      const char *str = va_arg(ap, const char *);
+      str = str != NULL ? str : "(null)";
+      rc = put_padded(fb, str, strlen(str), width, pad);
+      break;
+    }
+    case 'd':
+    case 'i': {
+      int64_t v = longs >= 2   ? (int64_t)va_arg(ap, long long)
+                  : longs == 1 ? (int64_t)va_arg(ap, long)
+                               : va_arg(ap, int);
+      if (longs == 0 && shorts > 0) {
+        v = shorts == 1 ? (short)v : (signed char)v;
+      }
+      uint64_t mag = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+      rc = put_number(fb, mag, v < 0, 10, width, pad);
+      break;
+    }
+    case 'u':
+    case 'x': {
+      uint64_t v = longs >= 2   ? (uint64_t)va_arg(ap, unsigned long long)
+                   : longs == 1 ? (uint64_t)va_arg(ap, unsigned long)
+                                : va_arg(ap, unsigned);
+      if (longs == 0 && shorts > 0) {
+        v = shorts == 1 ? (unsigned short)v : (unsigned char)v;
+      }
+      rc = put_number(fb, v, false, *spec == 'x' ? 16 : 10, width, pad);
+      break;
+    }
+    case 'p':
+      rc = put_ptr(fb, va_arg(ap, void *), width, pad);
+      break;
+    default:
+      // Not ours (another conversion, flag or a precision). Its argument
+      // can't be skipped without knowing its type, so every later one
+      // would be read wrong: mark the spot and stop.
+      fmtbuf_write(fb, "%?", 2);
+      errno = EINVAL;
+      rc = -1;
+      break;
+    }
+    fmt = spec + 1;
+  }
+  va_end(ap);
+  return rc;
+}
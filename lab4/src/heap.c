@@ -0,0 +1,987 @@
+// Lab 4 - general-purpose allocator on sbrk
+#define _GNU_SOURCE // sbrk, mremap
+#include "heap.h"
+#include "fmtbuf.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define HDR sizeof(header_t)
+#define MIN_BLOCK 32 /* header, back pointer and footer of a free block */
+#define HEAP_GROW (128 * 1024) /* least sbrk growth */
+#define MAX_REQUEST ((size_t)1 << 48)
+#define MMAP_THRESHOLD (128 * 1024) /* default */
+#define HUGE_PAGE ((size_t)2 << 20)
+#define TRIM_THRESHOLD ((size_t)1 << 20) /* free at the top before trimming */
+#define TRIM_KEEP HEAP_GROW /* left at the top by an automatic trim */
+#define TRIM_SPAN (64 * 1024) /* least free block heap_trim() advises */
+
+#define SMALL_BINS 65 /* bins 2..64: blocks of exactly 16*i bytes */
+#define SPLITS 4 /* then each [2^k, 2^k+1), k = 10..57, in four bins */
+#define NBINS (SMALL_BINS + 48 * SPLITS)
+#define FIT_SCAN 8 /* blocks tried in the request's own bin */
+
+#define TC_MAX_BLOCK 1024 /* largest block the thread caches keep */
+#define TC_CLASSES (TC_MAX_BLOCK / HEAP_ALIGN + 1)
+#define TC_BATCH_BYTES 8192 /* moved per refill or flush, roughly */
+#define REMOTE_CLOSED ((header_t *)1) /* owner thread has exited */
+
+typedef struct tcache {
+  header_t *bins[TC_CLASSES]; /* bins[c]: blocks of exactly 16*c bytes */
+  _Atomic uint32_t count[TC_CLASSES]; /* set by the owner, read by stats */
+  _Atomic(header_t *) remote; /* freed by other threads, not yet taken */
+  struct tcache *next_dead;
+  // What is on `remote`, by size class, for heap_stats()
+  _Atomic size_t remote_blocks[HEAP_STAT_CLASSES];
+  _Atomic size_t remote_bytes;
+  struct tcache *next_all; /* every cache ever made */
+} tcache_t;
+
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static header_t *bins[NBINS];
+static uint64_t bin_map[(NBINS + 63) / 64]; /* bit set: bin not empty */
+static header_t *heap_first; /* first block of the first stretch */
+static header_t *top;        /* epilogue of the newest stretch */
+static char *stretch_start;  /* of the newest stretch */
+static char *huge_mark;      /* heap below this is advised for THP */
+static size_t heap_bytes;    /* from sbrk */
+static size_t free_bytes;    /* on the free lists */
+static _Atomic size_t mmap_threshold = MMAP_THRESHOLD;
+static _Atomic size_t mmap_bytes;
+static _Atomic size_t mmap_blocks;
+static _Atomic size_t held_bytes; /* heap_bytes + mmap_bytes */
+static _Atomic size_t peak_bytes; /* of held_bytes */
+// Blocks the heap has handed out (to the program or a thread cache), by
+// size class. Only changed under the heap lock, but read without it.
+static _Atomic size_t out_blocks[HEAP_STAT_CLASSES];
+static _Atomic size_t out_bytes;
+static _Atomic size_t mmap_class[HEAP_STAT_CLASSES];
+static _Atomic(tcache_t *) all_caches;
+static tcache_t *dead_caches; /* of exited threads, for new ones */
+static pthread_key_t cache_key; /* runs cache_exit() at thread exit */
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static __thread tcache_t *my_cache;
+
+_Static_assert(sizeof(header_t) == HEAP_ALIGN, "payloads must stay aligned");
+
+/* ---------- blocks ---------- */
+
+// The header word of a block that the heap may be updating concurrently.
+static inline uint64_t size_word(const header_t *h) {
+  return __atomic_load_n(&h->size, __ATOMIC_RELAXED);
+}
+
+static inline header_t *next_block(header_t *h) {
+  return (header_t *)((char *)h + block_size(h));
+}
+
+// Only valid when the block before h is free (HEAP_PREV_USED clear).
+static inline header_t *prev_block(header_t *h) {
+  return (header_t *)((char *)h - ((uint64_t *)h)[-1]);
+}
+
+static inline header_t **back_link(header_t *h) {
+  return (header_t **)(h + 1);
+}
+
+static inline void set_footer(header_t *h) {
+  ((uint64_t *)next_block(h))[-1] = block_size(h);
+}
+
+// Block size for a request of n bytes.
+static inline size_t request_size(size_t n) {
+  size_t need = (n + HDR + HEAP_FLAGS) & ~(size_t)HEAP_FLAGS;
+  return need < MIN_BLOCK ? MIN_BLOCK : need;
+}
+
+/* ---------- free lists ---------- */
+
+static inline size_t bin_index(size_t size) {
+  if (size < SMALL_BINS * HEAP_ALIGN) {
+    return size / HEAP_ALIGN;
+  }
+  size_t k = (size_t)(63 - __builtin_clzll(size));
+  size_t quarter = (size >> (k - 2)) & (SPLITS - 1);
+  return SMALL_BINS + (k - 10) * SPLITS + quarter;
+}
+
+// Statistics size class: [32 << k, 64 << k), the last one open.
+static inline size_t stat_class(size_t size) {
+  size_t k = (size_t)(63 - __builtin_clzll(size)) - 5;
+  return k < HEAP_STAT_CLASSES ? k : HEAP_STAT_CLASSES - 1;
+}
+
+// Add to a counter that has a single writer at a time (the heap lock's
+// holder): a relaxed load and store, no locked instruction. `by` wraps
+// around to subtract.
+static inline void bump(_Atomic size_t *x, size_t by) {
+  atomic_store_explicit(
+      x, atomic_load_explicit(x, memory_order_relaxed) + by,
+      memory_order_relaxed);
+}
+
+static void bin_insert(header_t *h) {
+  size_t i = bin_index(block_size(h));
+  h->next = bins[i];
+  *back_link(h) = NULL;
+  if (bins[i] != NULL) {
+    *back_link(bins[i]) = h;
+  }
+  bins[i] = h;
+  bin_map[i / 64] |= 1ull << (i % 64);
+  free_bytes += block_size(h);
+}
+
+static void bin_remove(header_t *h) {
+  size_t i = bin_index(block_size(h));
+  header_t *prev = *back_link(h);
+  if (prev != NULL) {
+    prev->next = h->next;
+  } else {
+    bins[i] = h->next;
+    if (h->next == NULL) {
+      bin_map[i / 64] &= ~(1ull << (i % 64));
+    }
+  }
+  if (h->next != NULL) {
+    *back_link(h->next) = prev;
+  }
+  free_bytes -= block_size(h);
+}
+
+// Take a free block of at least `need` bytes off its list, or NULL.
+static header_t *find_fit(size_t need) {
+  size_t i = bin_index(need);
+  if (i >= SMALL_BINS) {
+    // Mixed sizes: first fit among the first few of the request's bin
+    int tries = FIT_SCAN;
+    for (header_t *h = bins[i]; h != NULL && tries-- > 0; h = h->next) {
+      if (block_size(h) >= need) {
+        bin_remove(h);
+        return h;
+      }
+    }
+    i++;
+  }
+  // Any block in a later bin is big enough
+  for (size_t w = i / 64; w < sizeof(bin_map) / sizeof(bin_map[0]); w++) {
+    uint64_t bits = bin_map[w];
+    if (w == i / 64) {
+      bits &= ~0ull << (i % 64);
+    }
+    if (bits != 0) {
+      header_t *h = bins[w * 64 + (size_t)__builtin_ctzll(bits)];
+      bin_remove(h);
+      return h;
+    }
+  }
+  return NULL;
+}
+
+/* ---------- splitting and merging ---------- */
+
+// Merge a free block (on no list) with free neighbours; returns the
+// merged block, still on no list.
+static header_t *coalesce(header_t *h) {
+  size_t size = block_size(h);
+  header_t *next = next_block(h);
+  if (!(next->size & HEAP_USED)) {
+    bin_remove(next);
+    size += block_size(next);
+  }
+  if (!(h->size & HEAP_PREV_USED)) {
+    header_t *prev = prev_block(h);
+    bin_remove(prev);
+    size += block_size(prev);
+    h = prev;
+  }
+  h->size = size | (h->size & HEAP_PREV_USED);
+  return h;
+}
+
+// File a free block (already merged) and tell its successor.
+static void make_free(header_t *h) {
+  h->size &= ~(uint64_t)HEAP_USED;
+  set_footer(h);
+  bin_insert(h);
+  __atomic_fetch_and(&next_block(h)->size, ~(uint64_t)HEAP_PREV_USED,
+                     __ATOMIC_RELAXED);
+}
+
+// Mark h (on no list) allocated with `need` bytes and free what is left
+// over if it can hold a block of its own.
+static void *use(header_t *h, size_t need) {
+  size_t size = block_size(h);
+  uint64_t prev_used = h->size & HEAP_PREV_USED;
+  h->next = NULL;
+  if (size - need >= MIN_BLOCK) {
+    h->size = need | HEAP_USED | prev_used;
+    header_t *rest = next_block(h);
+    rest->size = (size - need) | HEAP_PREV_USED;
+    make_free(coalesce(rest));
+  } else {
+    h->size = size | HEAP_USED | prev_used;
+    __atomic_fetch_or(&next_block(h)->size, HEAP_PREV_USED, __ATOMIC_RELAXED);
+  }
+  return h + 1;
+}
+
+// Count h as handed out by the heap (or, dir -1, as back).
+static inline void count_out(const header_t *h, int dir) {
+  size_t size = block_size(h);
+  bump(&out_blocks[stat_class(size)], (size_t)(ptrdiff_t)dir);
+  bump(&out_bytes, dir > 0 ? size : 0 - size);
+}
+
+/* ---------- growing the break ---------- */
+
+static inline uintptr_t align_up(uintptr_t x, size_t to) {
+  return (x + to - 1) & ~(uintptr_t)(to - 1);
+}
+
+// Advise the whole 2 MiB pages the newest stretch covers up to `end`.
+static void advise_huge(char *end) {
+  char *from = huge_mark > stretch_start ? huge_mark : stretch_start;
+  char *a = (char *)align_up((uintptr_t)from, HUGE_PAGE);
+  char *b = (char *)((uintptr_t)end & ~(uintptr_t)(HUGE_PAGE - 1));
+  if (b > a) {
+    madvise(a, (size_t)(b - a), MADV_HUGEPAGE); // a hint; errors are fine
+    huge_mark = b;
+  }
+}
+
+// Count n more bytes taken from the system (modulo 2^64, so a shrink can
+// pass its negation) and raise the peak to match.
+static void note_held(size_t n) {
+  size_t now =
+      atomic_fetch_add_explicit(&held_bytes, n, memory_order_relaxed) + n;
+  size_t peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+  while (now > peak && !atomic_compare_exchange_weak_explicit(
+                           &peak_bytes, &peak, now, memory_order_relaxed,
+                           memory_order_relaxed)) {
+  }
+}
+
+// Get at least `need` more bytes from sbrk. Returns a free block on no
+// list, merged with a free block that ended the old break, or NULL.
+static header_t *grow(size_t need) {
+  size_t n = need + 2 * HDR; /* room to align and for a new epilogue */
+  n = n < HEAP_GROW ? HEAP_GROW : (n + 4095) & ~(size_t)4095;
+  char *p = sbrk((intptr_t)n);
+  if (p == (void *)-1) {
+    return NULL;
+  }
+
+  header_t *h;
+  size_t size;
+  if (top != NULL && p == (char *)top + HDR) {
+    // Contiguous: the old epilogue becomes the new block's header
+    h = top;
+    size = n;
+  } else {
+    h = (header_t *)(((uintptr_t)p + HEAP_FLAGS) & ~(uintptr_t)HEAP_FLAGS);
+    size = ((size_t)(p + n - (char *)h) - HDR) & ~(size_t)HEAP_FLAGS;
+    h->size = HEAP_PREV_USED;
+    if (top != NULL) {
+      top->next = h;
+    } else {
+      heap_first = h;
+    }
+    stretch_start = p;
+  }
+  heap_bytes += n;
+  note_held(n);
+  h->size = size | (h->size & HEAP_PREV_USED);
+  top = next_block(h);
+  top->size = HEAP_USED; // empty epilogue; the block before it is free
+  top->next = NULL;
+  advise_huge(p + n);
+  return coalesce(h);
+}
+
+/* ---------- giving memory back ---------- */
+
+// Lower the break so that at most `keep` bytes stay free under the
+// epilogue. Only done when the break is still where this heap left it;
+// like glibc's own trimming, it relies on nobody else moving the break
+// concurrently. Returns the bytes released.
+static size_t trim_top(size_t keep) {
+  if (top == NULL || (top->size & HEAP_PREV_USED)) {
+    return 0;
+  }
+  header_t *last = prev_block(top);
+  size_t size = block_size(last);
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  if (size < keep + MIN_BLOCK + page || sbrk(0) != (char *)top + HDR) {
+    return 0;
+  }
+  size_t release = (size - keep - MIN_BLOCK) & ~(page - 1);
+  bin_remove(last);
+  if (sbrk(-(intptr_t)release) == (void *)-1) {
+    bin_insert(last);
+    return 0;
+  }
+  last->size = (size - release) | (last->size & HEAP_PREV_USED);
+  top = next_block(last);
+  top->size = HEAP_USED;
+  top->next = NULL;
+  make_free(last);
+  heap_bytes -= release;
+  atomic_fetch_sub_explicit(&held_bytes, release, memory_order_relaxed);
+  if (huge_mark > (char *)top) {
+    huge_mark = (char *)top; // advise again if the heap regrows
+  }
+  return release;
+}
+
+// Drop the pages inside free blocks of TRIM_SPAN bytes or more. The
+// header, back link and footer stay; the rest reads as zeros when next
+// used. Returns the bytes advised.
+static size_t release_spans(void) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t released = 0;
+  for (size_t i = bin_index(TRIM_SPAN); i < NBINS; i++) {
+    for (header_t *h = bins[i]; h != NULL; h = h->next) {
+      uintptr_t footer = (uintptr_t)next_block(h) - sizeof(uint64_t);
+      char *a = (char *)align_up((uintptr_t)h + MIN_BLOCK, page);
+      char *b = (char *)(footer & ~(uintptr_t)(page - 1));
+      if (b > a && madvise(a, (size_t)(b - a), MADV_DONTNEED) == 0) {
+        released += (size_t)(b - a);
+      }
+    }
+  }
+  return released;
+}
+
+// Free a heap block (on no list), trimming the top past the threshold.
+static void free_locked(header_t *h) {
+  count_out(h, -1);
+  h = coalesce(h);
+  make_free(h);
+  if (next_block(h) == top && block_size(h) >= TRIM_THRESHOLD + TRIM_KEEP) {
+    trim_top(TRIM_KEEP);
+  }
+}
+
+/* ---------- large blocks ---------- */
+
+// A block on a mapping of its own: page-rounded, and from 2 MiB on
+// rounded and aligned to huge pages (mapped with slack, then trimmed).
+static void *mmap_alloc(size_t need) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  bool huge = need >= HUGE_PAGE;
+  size_t len = align_up(need, huge ? HUGE_PAGE : page);
+  size_t map_len = huge ? len + HUGE_PAGE : len;
+  char *p = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  char *start = p;
+  if (huge) {
+    start = (char *)align_up((uintptr_t)p, HUGE_PAGE);
+    if (start > p) {
+      munmap(p, (size_t)(start - p));
+    }
+    if (start + len < p + map_len) {
+      munmap(start + len, (size_t)(p + map_len - start - len));
+    }
+    madvise(start, len, MADV_HUGEPAGE);
+  }
+  header_t *h = (header_t *)start;
+  h->size = len | HEAP_USED | HEAP_MMAPPED;
+  h->next = NULL;
+  atomic_fetch_add_explicit(&mmap_bytes, len, memory_order_relaxed);
+  atomic_fetch_add_explicit(&mmap_blocks, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&mmap_class[stat_class(len)], 1,
+                            memory_order_relaxed);
+  note_held(len);
+  return h + 1;
+}
+
+static void mmap_free(header_t *h) {
+  size_t len = block_size(h);
+  atomic_fetch_sub_explicit(&mmap_bytes, len, memory_order_relaxed);
+  atomic_fetch_sub_explicit(&mmap_blocks, 1, memory_order_relaxed);
+  atomic_fetch_sub_explicit(&mmap_class[stat_class(len)], 1,
+                            memory_order_relaxed);
+  atomic_fetch_sub_explicit(&held_bytes, len, memory_order_relaxed);
+  munmap(h, len);
+}
+
+// Resize a mapped block, letting the kernel move it. NULL on failure.
+static void *mmap_resize(header_t *h, size_t need) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t old = block_size(h);
+  size_t len = align_up(need, page);
+  if (len == old) {
+    return h + 1;
+  }
+  header_t *moved = mremap(h, old, len, MREMAP_MAYMOVE);
+  if (moved == MAP_FAILED) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  moved->size = len | HEAP_USED | HEAP_MMAPPED;
+  if (len >= HUGE_PAGE) {
+    madvise(moved, len, MADV_HUGEPAGE);
+  }
+  atomic_fetch_add_explicit(&mmap_bytes, len - old, memory_order_relaxed);
+  atomic_fetch_sub_explicit(&mmap_class[stat_class(old)], 1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&mmap_class[stat_class(len)], 1,
+                            memory_order_relaxed);
+  note_held(len - old); // wraps around to a decrease when shrinking
+  return moved + 1;
+}
+
+/* ---------- thread caches ---------- */
+
+static void *malloc_locked(size_t need) {
+  header_t *h = find_fit(need);
+  if (h == NULL && (h = grow(need)) == NULL) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  void *p = use(h, need);
+  count_out(h, 1);
+  return p;
+}
+
+static inline uint32_t batch_size(size_t c) {
+  size_t n = TC_BATCH_BYTES / (c * HEAP_ALIGN);
+  return n < 4 ? 4 : n > 64 ? 64 : (uint32_t)n;
+}
+
+// count[] has one writer, the owner; heap_stats() reads it from others.
+static inline void cache_count(tcache_t *tc, size_t c, int by) {
+  atomic_store_explicit(
+      &tc->count[c],
+      atomic_load_explicit(&tc->count[c], memory_order_relaxed) +
+          (uint32_t)by,
+      memory_order_relaxed);
+}
+
+// Hand the first n cached blocks of class c back to the heap.
+static void cache_flush(tcache_t *tc, size_t c, uint32_t n) {
+  pthread_mutex_lock(&heap_lock);
+  for (; n > 0 && tc->bins[c] != NULL; n--) {
+    header_t *h = tc->bins[c];
+    tc->bins[c] = h->next;
+    cache_count(tc, c, -1);
+    free_locked(h);
+  }
+  pthread_mutex_unlock(&heap_lock);
+}
+
+static void cache_put(tcache_t *tc, header_t *h) {
+  size_t c = block_size(h) / HEAP_ALIGN;
+  if (c >= TC_CLASSES) {
+    // Grown in place past what the caches keep
+    pthread_mutex_lock(&heap_lock);
+    free_locked(h);
+    pthread_mutex_unlock(&heap_lock);
+    return;
+  }
+  h->next = tc->bins[c];
+  tc->bins[c] = h;
+  cache_count(tc, c, 1);
+  uint32_t n = atomic_load_explicit(&tc->count[c], memory_order_relaxed);
+  if (n > 2 * batch_size(c)) {
+    cache_flush(tc, c, n - batch_size(c));
+  }
+}
+
+// Take in everything other threads freed back to this cache.
+static void cache_drain(tcache_t *tc, header_t *closed) {
+  header_t *h = atomic_exchange_explicit(&tc->remote, closed,
+                                         memory_order_acquire);
+  size_t blocks[HEAP_STAT_CLASSES] = {0};
+  size_t bytes = 0;
+  while (h != NULL && h != REMOTE_CLOSED) {
+    header_t *next = h->next;
+    blocks[stat_class(block_size(h))]++;
+    bytes += block_size(h);
+    cache_put(tc, h);
+    h = next;
+  }
+  for (size_t k = 0; k < HEAP_STAT_CLASSES; k++) {
+    if (blocks[k] != 0) {
+      atomic_fetch_sub_explicit(&tc->remote_blocks[k], blocks[k],
+                                memory_order_relaxed);
+    }
+  }
+  if (bytes != 0) {
+    atomic_fetch_sub_explicit(&tc->remote_bytes, bytes, memory_order_relaxed);
+  }
+}
+
+// A free from a thread that does not own the block: push it on the
+// owner's remote list, unless the owner has exited.
+static bool remote_push(tcache_t *owner, header_t *h) {
+  size_t size = block_size(h); // the owner may reuse h once it is pushed
+  header_t *head = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+  do {
+    if (head == REMOTE_CLOSED) {
+      return false;
+    }
+    h->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(
+      &owner->remote, &head, h, memory_order_release, memory_order_relaxed));
+  atomic_fetch_add_explicit(&owner->remote_blocks[stat_class(size)], 1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&owner->remote_bytes, size, memory_order_relaxed);
+  return true;
+}
+
+// Fill class c with a batch carved under one lock. A block that came
+// out 16 bytes larger (too little left to split off) goes to its own
+// class, so that every cached block has exactly its class's size.
+static void cache_refill(tcache_t *tc, size_t c) {
+  uint32_t n = batch_size(c);
+  pthread_mutex_lock(&heap_lock);
+  for (uint32_t i = 0; i < n; i++) {
+    void *p = malloc_locked(c * HEAP_ALIGN);
+    if (p == NULL) {
+      break;
+    }
+    header_t *h = block_of(p);
+    size_t k = block_size(h) / HEAP_ALIGN;
+    if (k >= TC_CLASSES) {
+      free_locked(h);
+      break;
+    }
+    h->next = tc->bins[k];
+    tc->bins[k] = h;
+    cache_count(tc, k, 1);
+  }
+  pthread_mutex_unlock(&heap_lock);
+}
+
+static header_t *cache_get(tcache_t *tc, size_t c) {
+  if (tc->bins[c] == NULL) {
+    cache_drain(tc, NULL);
+    if (tc->bins[c] == NULL) {
+      cache_refill(tc, c);
+      if (tc->bins[c] == NULL) {
+        return NULL;
+      }
+    }
+  }
+  header_t *h = tc->bins[c];
+  tc->bins[c] = h->next;
+  cache_count(tc, c, -1);
+  h->next = (header_t *)tc; // owner, for my_free
+  return h;
+}
+
+// Thread exit: close the remote list and return every cached block. The
+// cache itself is kept for the next thread; a block whose owner pointer
+// still names it then simply goes to that thread.
+static void cache_exit(void *arg) {
+  tcache_t *tc = arg;
+  cache_drain(tc, REMOTE_CLOSED);
+  for (size_t c = 0; c < TC_CLASSES; c++) {
+    cache_flush(tc, c, UINT32_MAX);
+  }
+  pthread_mutex_lock(&heap_lock);
+  tc->next_dead = dead_caches;
+  dead_caches = tc;
+  pthread_mutex_unlock(&heap_lock);
+  my_cache = NULL;
+}
+
+static void cache_key_init(void) {
+  pthread_key_create(&cache_key, cache_exit);
+}
+
+// This thread's cache, made on first use; NULL if even that fails.
+static tcache_t *get_cache(void) {
+  pthread_once(&cache_once, cache_key_init);
+  pthread_mutex_lock(&heap_lock);
+  tcache_t *tc = dead_caches;
+  if (tc != NULL) {
+    dead_caches = tc->next_dead;
+  } else if ((tc = malloc_locked(request_size(sizeof(*tc)))) != NULL) {
+    memset(tc, 0, sizeof(*tc));
+    count_out(block_of(tc), -1); // the allocator's own, not the program's
+    tc->next_all = atomic_load_explicit(&all_caches, memory_order_relaxed);
+    atomic_store_explicit(&all_caches, tc, memory_order_release);
+  }
+  pthread_mutex_unlock(&heap_lock);
+  if (tc == NULL) {
+    return NULL;
+  }
+  atomic_store_explicit(&tc->remote, NULL, memory_order_relaxed);
+  pthread_setspecific(cache_key, tc);
+  my_cache = tc;
+  return tc;
+}
+
+/* ---------- public API ---------- */
+
+void *my_malloc(size_t size) {
+  if (size > MAX_REQUEST) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  size_t need = request_size(size);
+  if (need >= atomic_load_explicit(&mmap_threshold, memory_order_relaxed)) {
+    return mmap_alloc(need);
+  }
+  if (need <= TC_MAX_BLOCK) {
+    tcache_t *tc = my_cache != NULL ? my_cache : get_cache();
+    header_t *h = tc != NULL ? cache_get(tc, need / HEAP_ALIGN) : NULL;
+    if (h != NULL) {
+      return h + 1;
+    }
+  }
+  pthread_mutex_lock(&heap_lock);
+  void *p = malloc_locked(need);
+  pthread_mutex_unlock(&heap_lock);
+  return p;
+}
+
+void my_free(void *p) {
+  if (p == NULL) {
+    return;
+  }
+  header_t *h = block_of(p);
+  if (size_word(h) & HEAP_MMAPPED) {
+    mmap_free(h);
+    return;
+  }
+  tcache_t *owner = (tcache_t *)h->next;
+  if (owner != NULL && owner == my_cache) {
+    cache_put(owner, h);
+    return;
+  }
+  if (owner != NULL && remote_push(owner, h)) {
+    return;
+  }
+  pthread_mutex_lock(&heap_lock);
+  free_locked(h);
+  pthread_mutex_unlock(&heap_lock);
+}
+
+void *my_calloc(size_t n, size_t size) {
+  size_t bytes;
+  if (__builtin_mul_overflow(n, size, &bytes)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  void *p = my_malloc(bytes);
+  if (p != NULL) {
+    memset(p, 0, bytes);
+  }
+  return p;
+}
+
+// Resize h's block in place to `need` bytes: shrink, take over a free
+// successor, or extend the break when h is the last block. Returns false
+// (changing nothing) when none of these fits.
+static bool resize_in_place(header_t *h, size_t need) {
+  size_t size = block_size(h);
+  header_t *next = next_block(h);
+  if (need > size && !(next->size & HEAP_USED) &&
+      size + block_size(next) >= need) {
+    bin_remove(next);
+    size += block_size(next);
+  } else if (need > size && next == top) {
+    header_t *more = grow(need - size);
+    if (more == NULL) {
+      return false;
+    }
+    if (more != next) {
+      make_free(more); // the break had moved; keep the memory for later
+      return false;
+    }
+    size += block_size(more);
+  } else if (need > size) {
+    return false;
+  }
+  count_out(h, -1);
+  h->size = size | (h->size & HEAP_PREV_USED);
+  use(h, need);
+  count_out(h, 1);
+  return true;
+}
+
+void *my_realloc(void *p, size_t size) {
+  if (p == NULL) {
+    return my_malloc(size);
+  }
+  if (size == 0) {
+    my_free(p);
+    return NULL;
+  }
+  if (size > MAX_REQUEST) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  size_t need = request_size(size);
+  header_t *h = block_of(p);
+  size_t old = block_size(h) - HDR;
+  size_t threshold =
+      atomic_load_explicit(&mmap_threshold, memory_order_relaxed);
+  if (size_word(h) & HEAP_MMAPPED) {
+    if (need >= threshold) {
+      return mmap_resize(h, need);
+    }
+  } else if (need < threshold) {
+    // Resized in place, a block leaves its thread cache for the heap
+    pthread_mutex_lock(&heap_lock);
+    bool done = resize_in_place(h, need);
+    pthread_mutex_unlock(&heap_lock);
+    if (done) {
+      return p;
+    }
+  }
+  void *q = my_malloc(size);
+  if (q != NULL) {
+    memcpy(q, p, old < size ? old : size);
+    my_free(p);
+  }
+  return q;
+}
+
+size_t my_usable_size(void *p) {
+  return p != NULL ? block_size(block_of(p)) - HDR : 0;
+}
+
+void heap_set_mmap_threshold(size_t bytes) {
+  // Past MAX_REQUEST request_size() would wrap; nothing that large is
+  // ever served, so the mmap path is simply off
+  size_t need = bytes > MAX_REQUEST ? SIZE_MAX : request_size(bytes);
+  atomic_store_explicit(&mmap_threshold, need, memory_order_relaxed);
+}
+
+size_t heap_trim(size_t pad) {
+  tcache_t *tc = my_cache;
+  if (tc != NULL) {
+    cache_drain(tc, NULL);
+    for (size_t c = 0; c < TC_CLASSES; c++) {
+      cache_flush(tc, c, UINT32_MAX);
+    }
+  }
+  pthread_mutex_lock(&heap_lock);
+  size_t released = trim_top(pad);
+  released += release_spans();
+  pthread_mutex_unlock(&heap_lock);
+  return released;
+}
+
+// Biggest block on the free lists: the largest in the highest bin in use.
+static size_t largest_free_locked(void) {
+  for (size_t w = sizeof(bin_map) / sizeof(bin_map[0]); w-- > 0;) {
+    if (bin_map[w] == 0) {
+      continue;
+    }
+    size_t i = w * 64 + (size_t)(63 - __builtin_clzll(bin_map[w]));
+    size_t best = 0;
+    for (header_t *h = bins[i]; h != NULL; h = h->next) {
+      best = block_size(h) > best ? block_size(h) : best;
+    }
+    return best;
+  }
+  return 0;
+}
+
+// Take what sits in tc (its bins and its remote list) off st's counts.
+static void sub_cached(heap_stats_t *st, tcache_t *tc) {
+  for (size_t c = MIN_BLOCK / HEAP_ALIGN; c < TC_CLASSES; c++) {
+    size_t n = atomic_load_explicit(&tc->count[c], memory_order_relaxed);
+    st->blocks[stat_class(c * HEAP_ALIGN)] -= n;
+    st->in_use -= n * c * HEAP_ALIGN;
+  }
+  for (size_t k = 0; k < HEAP_STAT_CLASSES; k++) {
+    st->blocks[k] -=
+        atomic_load_explicit(&tc->remote_blocks[k], memory_order_relaxed);
+  }
+  st->in_use -= atomic_load_explicit(&tc->remote_bytes, memory_order_relaxed);
+}
+
+// Fill in st. The program holds what the heap and mmap handed out less
+// what sits in thread caches; these counters are read without the heap
+// lock. With `wait` false the lock is only tried, and false is returned
+// (the figures that need it left at 0) when it is taken.
+static bool collect(heap_stats_t *st, bool wait) {
+  memset(st, 0, sizeof(*st));
+  st->in_use = atomic_load_explicit(&out_bytes, memory_order_relaxed);
+  for (size_t k = 0; k < HEAP_STAT_CLASSES; k++) {
+    st->blocks[k] =
+        atomic_load_explicit(&out_blocks[k], memory_order_relaxed) +
+        atomic_load_explicit(&mmap_class[k], memory_order_relaxed);
+  }
+  for (tcache_t *tc = atomic_load_explicit(&all_caches, memory_order_acquire);
+       tc != NULL; tc = tc->next_all) {
+    sub_cached(st, tc);
+  }
+  st->mmap_bytes = atomic_load_explicit(&mmap_bytes, memory_order_relaxed);
+  st->mmap_blocks = atomic_load_explicit(&mmap_blocks, memory_order_relaxed);
+  st->peak_bytes = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+  st->in_use += st->mmap_bytes;
+
+  if (wait) {
+    pthread_mutex_lock(&heap_lock);
+  } else if (pthread_mutex_trylock(&heap_lock) != 0) {
+    return false;
+  }
+  st->heap_bytes = heap_bytes;
+  st->heap_free = free_bytes;
+  st->largest_free = largest_free_locked();
+  pthread_mutex_unlock(&heap_lock);
+
+  size_t on_heap =
+      st->in_use > st->mmap_bytes ? st->in_use - st->mmap_bytes : 0;
+  if (st->heap_bytes > st->heap_free + on_heap) {
+    st->cached = st->heap_bytes - st->heap_free - on_heap;
+  }
+  if (st->heap_free > 0) {
+    st->fragmentation =
+        1.0 - (double)st->largest_free / (double)st->heap_free;
+  }
+  return true;
+}
+
+void heap_stats(heap_stats_t *st) {
+  collect(st, true);
+}
+
+static void dump_stats(int fd, bool wait) {
+  heap_stats_t st;
+  bool full = collect(&st, wait);
+  fmtbuf_t out;
+  fmtbuf_init(&out, fd);
+  fmtbuf_printf(&out, "heap stats (pid %d)\n", (int)getpid());
+  fmtbuf_printf(&out, "  in use:        %zu bytes\n", st.in_use);
+  fmtbuf_printf(&out, "  peak held:     %zu bytes\n", st.peak_bytes);
+  fmtbuf_printf(&out, "  mmap:          %zu bytes in %zu blocks\n",
+                st.mmap_bytes, st.mmap_blocks);
+  if (full) {
+    unsigned tenths = (unsigned)(st.fragmentation * 1000.0 + 0.5);
+    fmtbuf_printf(&out, "  heap:          %zu bytes, %zu free, %zu cached\n",
+                  st.heap_bytes, st.heap_free, st.cached);
+    fmtbuf_printf(&out, "  largest free:  %zu bytes\n", st.largest_free);
+    fmtbuf_printf(&out, "  fragmentation: %u.%u%%\n", tenths / 10,
+                  tenths % 10);
+  } else {
+    fmtbuf_str(&out, "  heap:          busy, not read\n");
+  }
+  fmtbuf_str(&out, "  blocks held by size:\n");
+  for (size_t k = 0; k < HEAP_STAT_CLASSES; k++) {
+    if (st.blocks[k] == 0) {
+      continue;
+    }
+    if (k + 1 < HEAP_STAT_CLASSES) {
+      fmtbuf_printf(&out, "    %9zu - %9zu  %zu\n", (size_t)32 << k,
+                    ((size_t)64 << k) - 1, st.blocks[k]);
+    } else {
+      fmtbuf_printf(&out, "    %9zu and up     %zu\n", (size_t)32 << k,
+                    st.blocks[k]);
+    }
+  }
+  fmtbuf_flush(&out);
+}
+
+void heap_dump_stats(int fd) {
+  dump_stats(fd, true);
+}
+
+static void stats_signal(int signo) {
+  (void)signo;
+  dump_stats(STDERR_FILENO, false); // the lock may be ours, interrupted
+}
+
+int heap_stats_on_signal(int signo) {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stats_signal;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  return sigaction(signo, &sa, NULL);
+}
+
+/* ---------- consistency check ---------- */
+
+static int check_fail(const char *what, const header_t *h) {
+  // stdio may allocate, and this runs with the heap in an odd state
+  fmtbuf_t err;
+  fmtbuf_init(&err, STDERR_FILENO);
+  fmtbuf_printf(&err, "heap_check: %s at %p\n", what, (const void *)h);
+  fmtbuf_flush(&err);
+  return -1;
+}
+
+static int check_locked(void) {
+  size_t free_blocks = 0, free_total = 0;
+  for (header_t *h = heap_first; h != NULL;) {
+    if ((uintptr_t)h % HEAP_ALIGN != 0) {
+      return check_fail("misaligned block", h);
+    }
+    if (block_size(h) == 0) {
+      h = h->next; // epilogue: on to the next stretch
+      continue;
+    }
+    header_t *next = next_block(h);
+    bool used = h->size & HEAP_USED;
+    if (!used) {
+      free_blocks++;
+      free_total += block_size(h);
+      if (!(next->size & HEAP_USED)) {
+        return check_fail("two free blocks in a row", h);
+      }
+      if (((uint64_t *)next)[-1] != block_size(h)) {
+        return check_fail("bad footer", h);
+      }
+    }
+    if (block_size(h) < MIN_BLOCK) {
+      return check_fail("block too small", h);
+    }
+    if (!(next->size & HEAP_PREV_USED) != !used) {
+      return check_fail("stale prev-used bit", next);
+    }
+    h = next;
+  }
+
+  size_t listed = 0;
+  for (size_t i = 0; i < NBINS; i++) {
+    bool mapped = bin_map[i / 64] & (1ull << (i % 64));
+    if (mapped != (bins[i] != NULL)) {
+      return check_fail("bin map out of date", bins[i]);
+    }
+    header_t *prev = NULL;
+    for (header_t *h = bins[i]; h != NULL; prev = h, h = h->next) {
+      if ((h->size & HEAP_USED) || bin_index(block_size(h)) != i) {
+        return check_fail("wrong block on a free list", h);
+      }
+      if (*back_link(h) != prev) {
+        return check_fail("bad back link", h);
+      }
+      listed++;
+    }
+  }
+  if (listed != free_blocks) {
+    return check_fail("free blocks missing from the lists", NULL);
+  }
+  if (free_total != free_bytes) {
+    return check_fail("free byte count out of date", NULL);
+  }
+  return 0;
+}
+
+int heap_check(void) {
+  pthread_mutex_lock(&heap_lock);
+  int rc = check_locked();
+  pthread_mutex_unlock(&heap_lock);
+  return rc;
+}
@@ -0,0 +1,520 @@
+// Lab 4 - allocator throughput against glibc malloc
+//
+// Each thread keeps a working set of live blocks and replaces a random one
+// per step (free it, allocate a new random size), for small (16-128 B) and
+// medium (1-16 KiB) requests, through glibc malloc and through my_malloc.
+// In the "remote" pattern each thread instead passes every block it
+// allocates to the next thread through a mailbox and frees the blocks the
+// previous thread passed to it, so most frees happen off the owner thread.
+// The pairs are split over 1, 2, 4, ... up to -t threads, and each CSV row
+// gives malloc/free pairs per second for all threads together. The slot
+// and size sequence comes from a fixed seed and is generated before the
+// timed loop, so both allocators see the same work.
+//
+// -V instead runs a randomized self-check of my_malloc, my_calloc,
+// my_realloc and my_free: every block is filled with a pattern that is
+// verified before it is resized or freed, heap_check() walks the heap as
+// it goes, heap_stats() must count exactly the blocks held, and
+// heap_trim() runs now and then. It then runs the threaded patterns on
+// my_malloc (most frees remote) and checks the heap and the counts again.
+// Exits non-zero on the first problem.
+//
+// -R MiB checks that memory goes back to the system: it allocates a burst
+// of 1-16 KiB blocks, frees them all but one pinned near the top of the
+// heap, calls heap_trim(), then frees the pin, and writes the RSS after
+// each step. Exits non-zero unless heap_trim() brought RSS below half of
+// the peak.
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "heap.h"
+
+#define DEFAULT_OPS 2000000
+#define DEFAULT_THREADS 32
+#define LIVE 4096 /* blocks kept allocated, per thread */
+#define MAX_THREADS 64
+#define MAILBOX 1024 /* blocks in flight between two threads */
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t rng_range(size_t lo, size_t hi) {
+  return lo + (size_t)(rng() % (hi - lo + 1));
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* ---------- throughput ---------- */
+
+typedef struct {
+  const char *name;
+  void *(*alloc)(size_t);
+  void (*release)(void *);
+} allocator_t;
+
+static const allocator_t allocators[] = {
+    {"glibc", malloc, free},
+    {"my_malloc", my_malloc, my_free},
+};
+
+typedef struct {
+  const char *name;
+  size_t lo, hi;
+} size_range_t;
+
+static const size_range_t ranges[] = {
+    {"small", 16, 128},
+    {"medium", 1024, 16384},
+};
+
+typedef struct {
+  const allocator_t *a;
+  const uint32_t *slots;
+  const uint32_t *sizes;
+  size_t ops;     /* pairs for this thread */
+  size_t id;
+  size_t threads;
+  bool remote;
+  pthread_barrier_t *start; /* the timed loop runs between these two */
+  pthread_barrier_t *stop;
+} worker_t;
+
+static _Atomic(void *) mail[MAX_THREADS][MAILBOX]; /* mail[k]: for k */
+
+static void *alloc_or_die(const allocator_t *a, size_t size) {
+  void *p = a->alloc(size);
+  if (p == NULL) {
+    perror(a->name);
+    exit(EXIT_FAILURE);
+  }
+  *(char *)p = 1; // touch it, as a caller would
+  return p;
+}
+
+static void run_local(const worker_t *w) {
+  void **live = malloc(LIVE * sizeof(*live));
+  if (live == NULL) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < LIVE; i++) {
+    live[i] = alloc_or_die(w->a, w->sizes[i % w->ops]);
+  }
+  pthread_barrier_wait(w->start);
+  for (size_t i = 0; i < w->ops; i++) {
+    uint32_t s = w->slots[i];
+    w->a->release(live[s]);
+    live[s] = alloc_or_die(w->a, w->sizes[i]);
+  }
+  pthread_barrier_wait(w->stop);
+  for (size_t i = 0; i < LIVE; i++) {
+    w->a->release(live[i]);
+  }
+  free(live);
+}
+
+static void run_remote(const worker_t *w) {
+  _Atomic(void *) *in = mail[w->id];
+  _Atomic(void *) *out = mail[(w->id + 1) % w->threads];
+  pthread_barrier_wait(w->start);
+  for (size_t i = 0; i < w->ops; i++) {
+    uint32_t s = w->slots[i] % MAILBOX;
+    w->a->release(atomic_exchange(&in[s], NULL)); // the previous thread's
+    void *p = alloc_or_die(w->a, w->sizes[i]);
+    w->a->release(atomic_exchange(&out[s], p)); // not taken yet: our own
+  }
+  pthread_barrier_wait(w->stop);
+}
+
+static void *worker(void *arg) {
+  const worker_t *w = arg;
+  if (w->remote) {
+    run_remote(w);
+  } else {
+    run_local(w);
+  }
+  return NULL;
+}
+
+// Run `ops` pairs split over `threads` threads; returns the wall time of
+// the timed loops (setup and teardown excluded).
+static double run_pairs(const allocator_t *a, const uint32_t *slots,
+                        const uint32_t *sizes, size_t ops, size_t threads,
+                        bool remote) {
+  pthread_t tids[MAX_THREADS];
+  worker_t workers[MAX_THREADS];
+  pthread_barrier_t start, stop;
+  pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+  pthread_barrier_init(&stop, NULL, (unsigned)threads + 1);
+  for (size_t k = 0; k < threads; k++) {
+    workers[k] = (worker_t){a, slots, sizes, ops / threads, k, threads,
+                            remote, &start, &stop};
+    if (pthread_create(&tids[k], NULL, worker, &workers[k]) != 0) {
+      perror("pthread_create");
+      exit(EXIT_FAILURE);
+    }
+  }
+  pthread_barrier_wait(&start);
+  double t0 = now_seconds();
+  pthread_barrier_wait(&stop);
+  double secs = now_seconds() - t0;
+  for (size_t k = 0; k < threads; k++) {
+    pthread_join(tids[k], NULL);
+  }
+  pthread_barrier_destroy(&start);
+  pthread_barrier_destroy(&stop);
+  for (size_t k = 0; k < threads; k++) {
+    for (size_t s = 0; s < MAILBOX; s++) {
+      a->release(atomic_exchange(&mail[k][s], NULL));
+    }
+  }
+  return secs;
+}
+
+/* ---------- self-check ---------- */
+
+typedef struct {
+  unsigned char *p;
+  size_t size;
+  unsigned char fill;
+} shadow_t;
+
+static bool check_block(const shadow_t *b) {
+  if ((uintptr_t)b->p % HEAP_ALIGN != 0 || my_usable_size(b->p) < b->size) {
+    fprintf(stderr, "bad block %p (%zu bytes)\n", (void *)b->p, b->size);
+    return false;
+  }
+  for (size_t i = 0; i < b->size; i++) {
+    if (b->p[i] != b->fill) {
+      fprintf(stderr, "block %p byte %zu: %d, expected %d\n", (void *)b->p,
+              i, b->p[i], b->fill);
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t random_size(void) {
+  switch (rng() % 8) {
+  case 0:
+    return 0;
+  case 1:
+    if (rng() % 512 == 0) {
+      return rng_range(2 << 20, 3 << 20); // huge-page mapping
+    }
+    return rng_range(4096, 1 << 18);
+  default:
+    return rng_range(1, 512);
+  }
+}
+
+// heap_stats() must show what `blocks` holds on top of `base`.
+static bool counts_agree(const shadow_t *blocks, size_t n,
+                         const heap_stats_t *base) {
+  size_t held = 0, bytes = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (blocks[i].p != NULL) {
+      held++;
+      bytes += my_usable_size(blocks[i].p) + sizeof(header_t);
+    }
+  }
+  heap_stats_t st;
+  heap_stats(&st);
+  size_t counted = 0;
+  for (size_t k = 0; k < HEAP_STAT_CLASSES; k++) {
+    counted += st.blocks[k] - base->blocks[k];
+  }
+  if (counted != held || st.in_use - base->in_use != bytes) {
+    fprintf(stderr, "heap_stats: %zu blocks, %zu bytes; expected %zu, %zu\n",
+            counted, st.in_use - base->in_use, held, bytes);
+    return false;
+  }
+  return true;
+}
+
+static int self_check(size_t ops) {
+  static shadow_t blocks[LIVE];
+  heap_stats_t base;
+  heap_stats(&base);
+  for (size_t i = 0; i < ops; i++) {
+    shadow_t *b = &blocks[rng() % LIVE];
+    if (b->p != NULL && !check_block(b)) {
+      return EXIT_FAILURE;
+    }
+    unsigned op = (unsigned)(rng() % 4);
+    size_t size = random_size();
+    if (op == 0 && b->p != NULL) {
+      my_free(b->p);
+      b->p = NULL;
+      continue;
+    } else if (op == 1 && b->p != NULL) {
+      unsigned char *q = my_realloc(b->p, size);
+      if (size == 0) {
+        b->p = NULL;
+        continue;
+      }
+      if (q == NULL) {
+        perror("my_realloc");
+        return EXIT_FAILURE;
+      }
+      // The common prefix must have survived the move
+      b->p = q;
+      b->size = b->size < size ? b->size : size;
+      if (!check_block(b)) {
+        return EXIT_FAILURE;
+      }
+      b->size = size;
+    } else {
+      my_free(b->p);
+      b->p = op == 2 ? my_calloc(1, size) : my_malloc(size);
+      if (b->p == NULL) {
+        perror("my_malloc");
+        return EXIT_FAILURE;
+      }
+      b->size = size;
+      b->fill = 0;
+      if (op == 2 && !check_block(b)) {
+        return EXIT_FAILURE; // calloc memory must read as zeros
+      }
+    }
+    b->fill = (unsigned char)(rng() | 1);
+    memset(b->p, b->fill, b->size);
+    if (i % 65536 == 0) {
+      heap_trim(0); // live blocks must not notice
+    }
+    if (i % 1024 == 0 &&
+        (heap_check() < 0 || !counts_agree(blocks, LIVE, &base))) {
+      return EXIT_FAILURE;
+    }
+  }
+  for (size_t i = 0; i < LIVE; i++) {
+    if (blocks[i].p != NULL && !check_block(&blocks[i])) {
+      return EXIT_FAILURE;
+    }
+    my_free(blocks[i].p);
+    blocks[i].p = NULL;
+  }
+  if (heap_check() < 0 || !counts_agree(blocks, 0, &base)) {
+    return EXIT_FAILURE;
+  }
+
+  uint32_t *slots = malloc(ops * sizeof(*slots));
+  uint32_t *sizes = malloc(ops * sizeof(*sizes));
+  if (slots == NULL || sizes == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < ops; i++) {
+    slots[i] = (uint32_t)(rng() % LIVE);
+    sizes[i] = (uint32_t)random_size();
+  }
+  run_pairs(&allocators[1], slots, sizes, ops, 8, true);
+  run_pairs(&allocators[1], slots, sizes, ops, 8, false);
+  free(sizes);
+  free(slots);
+  if (heap_check() < 0 || !counts_agree(blocks, 0, &base)) {
+    return EXIT_FAILURE; // every thread freed all it had, mostly remotely
+  }
+  printf("self-check passed: %zu operations\n", ops);
+  return EXIT_SUCCESS;
+}
+
+/* ---------- RSS after a burst ---------- */
+
+static size_t rss_kib(void) {
+  unsigned long pages = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f != NULL) {
+    if (fscanf(f, "%lu %lu", &pages, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(f);
+  }
+  return resident * (size_t)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+static size_t rss_row(FILE *csv, const char *label, const char *phase) {
+  heap_stats_t st;
+  heap_stats(&st);
+  size_t rss = rss_kib();
+  fprintf(csv, "%s,%s,%zu,%zu,%zu\n", label, phase, rss, st.heap_bytes,
+          st.heap_free);
+  fflush(csv);
+  return rss;
+}
+
+static int burst_check(FILE *csv, const char *label, size_t mib) {
+  size_t cap = (mib << 20) / 1024 + 1;
+  void **blocks = malloc(cap * sizeof(*blocks));
+  if (blocks == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  fprintf(csv, "label,phase,rss_kib,heap_bytes,heap_free\n");
+  rss_row(csv, label, "start");
+
+  size_t n = 0;
+  for (size_t total = 0; total < mib << 20 && n < cap; n++) {
+    size_t size = rng_range(1024, 16384);
+    blocks[n] = my_malloc(size);
+    if (blocks[n] == NULL) {
+      perror("my_malloc");
+      return EXIT_FAILURE;
+    }
+    memset(blocks[n], 1, size);
+    total += size;
+  }
+  void *pin = my_malloc(4096); // the newest block, so near the top
+  size_t peak = rss_row(csv, label, "burst");
+
+  for (size_t i = 0; i < n; i++) {
+    my_free(blocks[i]);
+  }
+  rss_row(csv, label, "freed_pinned");
+  heap_trim(0);
+  size_t trimmed = rss_row(csv, label, "heap_trim");
+  my_free(pin);
+  rss_row(csv, label, "unpinned");
+  free(blocks);
+
+  if (trimmed * 2 > peak) {
+    fprintf(stderr, "RSS only fell from %zu to %zu KiB\n", peak, trimmed);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* ---------- driver ---------- */
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-n ops] [-t threads] [-l label] [-o results.csv]\n"
+          "       %s -V [-n ops]\n"
+          "       %s -R MiB [-l label]\n"
+          "  -n  malloc/free pairs per run, split over the threads "
+          "(default %d)\n"
+          "  -t  most threads to run with (default %d, max %d)\n"
+          "  -l  build label written to every row (default \"dev\")\n"
+          "  -o  append CSV rows to this file instead of stdout\n"
+          "  -V  run the randomized allocator self-check instead\n"
+          "  -R  check that RSS falls after a burst of this many MiB\n",
+          prog, prog, prog, DEFAULT_OPS, DEFAULT_THREADS, MAX_THREADS);
+}
+
+int main(int argc, char *argv[]) {
+  size_t ops = DEFAULT_OPS;
+  size_t max_threads = DEFAULT_THREADS;
+  const char *label = "dev";
+  const char *csv_path = NULL;
+  bool verify = false;
+  size_t burst_mib = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:t:l:o:VR:")) != -1) {
+    switch (opt) {
+    case 'n':
+      ops = strtoul(optarg, NULL, 10);
+      break;
+    case 't':
+      max_threads = strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      label = optarg;
+      break;
+    case 'o':
+      csv_path = optarg;
+      break;
+    case 'V':
+      verify = true;
+      break;
+    case 'R':
+      burst_mib = strtoul(optarg, NULL, 10);
+      if (burst_mib == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (ops == 0 || max_threads == 0 || max_threads > MAX_THREADS) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (verify) {
+    return self_check(ops);
+  }
+  if (burst_mib != 0) {
+    return burst_check(stdout, label, burst_mib);
+  }
+
+  FILE *csv = stdout;
+  if (csv_path != NULL) {
+    csv = fopen(csv_path, "a");
+    if (csv == NULL) {
+      perror(csv_path);
+      return EXIT_FAILURE;
+    }
+  }
+  uint32_t *slots = malloc(ops * sizeof(*slots));
+  uint32_t *sizes = malloc(ops * sizeof(*sizes));
+  if (slots == NULL || sizes == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  if (csv_path == NULL || ftell(csv) == 0) {
+    fprintf(csv, "label,impl,sizes,pattern,threads,ops,seconds,ops_per_s\n");
+  }
+
+  for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+    for (size_t i = 0; i < ops; i++) {
+      slots[i] = (uint32_t)(rng() % LIVE);
+      sizes[i] = (uint32_t)rng_range(ranges[r].lo, ranges[r].hi);
+    }
+    for (int remote = 0; remote <= 1; remote++) {
+      for (size_t t = 1; t <= max_threads; t *= 2) {
+        for (size_t a = 0; a < sizeof(allocators) / sizeof(allocators[0]);
+             a++) {
+          double secs = run_pairs(&allocators[a], slots, sizes, ops, t,
+                                  remote);
+          size_t done = ops / t * t;
+          fprintf(csv, "%s,%s,%s,%s,%zu,%zu,%.6f,%.0f\n", label,
+                  allocators[a].name, ranges[r].name,
+                  remote ? "remote" : "local", t, done, secs,
+                  (double)done / secs);
+          fflush(csv);
+        }
+        if (t < max_threads && t * 2 > max_threads) {
+          t = max_threads / 2; // end on max_threads itself
+        }
+      }
+    }
+  }
+
+  free(sizes);
+  free(slots);
+  if (csv != stdout) {
+    fclose(csv);
+  }
+  return EXIT_SUCCESS;
+}
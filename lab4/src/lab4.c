@@ -0,0 +1,135 @@
+// lab4.c
+
+// Enable glibc defaults so sbrk() is declared even without POSIX.
+// (Alternatively: compile with -D_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+
+#include <assert.h> // <-- add this
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // strerror, memset
+#include <unistd.h>
+
+#include "fmtbuf.h"
+#include "heap.h"
+
+// All output is queued here (a buffer on main's stack) and written in a
+// few large writes, not one write(2) per value.
+static fmtbuf_t *out;
+
+static void handle_error(const char *msg) {
+  // Minimal, heap-free error path.
+  // Print "<msg>: <strerror>\n" to STDERR and exit(1).
+  const char *reason = strerror(errno);
+  fmtbuf_t err;
+  if (out != NULL) {
+    fmtbuf_flush(out);
+  }
+  fmtbuf_init(&err, STDERR_FILENO);
+  fmtbuf_printf(&err, "%s: %s\n", msg, reason);
+  fmtbuf_flush(&err);
+  _exit(1);
+}
+
+// What print_out did with snprintf and a write per value, without either.
+static inline void print_ptr(const char *fmt, const void *p) {
+  fmtbuf_printf(out, fmt, p);
+}
+static inline void print_u64(const char *fmt, uint64_t v) {
+  fmtbuf_printf(out, fmt, v);
+}
+
+// -------- Block header & layout --------
+// header_t (see heap.h) now fronts every block the allocator hands out.
+enum { REGION_SIZE = 256, BLOCKS = 2, BLOCK_SIZE = REGION_SIZE / BLOCKS };
+
+static_assert(BLOCK_SIZE >= (int)sizeof(header_t),
+              "Block too small for header");
+static_assert((BLOCK_SIZE % alignof(max_align_t)) == 0 ||
+                  sizeof(void *) <= (size_t)BLOCK_SIZE,
+              "Block size should be reasonable for alignment");
+
+// Return the data payload byte-count inside a block (block size minus header).
+static inline size_t payload_size(void) {
+  return (size_t)BLOCK_SIZE - sizeof(header_t);
+}
+
+int main(void) {
+  fmtbuf_t stdout_buf;
+  fmtbuf_init(&stdout_buf, STDOUT_FILENO);
+  out = &stdout_buf;
+
+  // kill -USR1 <pid> dumps the heap counters to stderr.
+  if (heap_stats_on_signal(SIGUSR1) < 0) {
+    handle_error("sigaction");
+  }
+
+  // 1) Allocate two blocks of 128 bytes each (header included).
+  const size_t nbytes = payload_size();
+  uint8_t *first_data = my_malloc(nbytes);
+  uint8_t *second_data = my_malloc(nbytes);
+  if (first_data == NULL || second_data == NULL) {
+    handle_error("my_malloc");
+  }
+
+  // 2) The headers sit immediately before the payloads.
+  header_t *first = block_of(first_data);
+  header_t *second = block_of(second_data);
+
+  // 3) Initialize payloads: first -> zeros, second -> ones.
+  memset(first_data, 0x00, nbytes);
+  memset(second_data, 0x01, nbytes);
+
+  // 4) Print addresses, header fields, and payload contents.
+  // Addresses of each block (header addresses)
+  print_ptr("first block:       %p\n", (void *)first);
+  print_ptr("second block:      %p\n", (void *)second);
+
+  // Header values (size without flag bits; next names the thread cache)
+  print_u64("first block size:  %" PRIu64 "\n", block_size(first));
+  print_ptr("first block next:  %p\n", (void *)first->next);
+  print_u64("second block size: %" PRIu64 "\n", block_size(second));
+  print_ptr("second block next: %p\n", (void *)second->next);
+
+  // Payload bytes: many 0s then many 1s (one per line, like the example)
+  for (size_t i = 0; i < nbytes; ++i) {
+    print_u64("%" PRIu64 "\n", (uint64_t)first_data[i]); // 0
+  }
+  for (size_t i = 0; i < nbytes; ++i) {
+    print_u64("%" PRIu64 "\n", (uint64_t)second_data[i]); // 1
+  }
+
+  // Give both blocks back; they merge into the free space behind them.
+  my_free(second_data);
+  my_free(first_data);
+  if (heap_check() < 0) {
+    return 1;
+  }
+
+  // 5) A large block gets a mapping of its own instead of heap space.
+  void *large = my_malloc(1 << 20);
+  if (large == NULL) {
+    handle_error("my_malloc");
+  }
+  heap_stats_t st;
+  heap_stats(&st);
+  print_u64("heap bytes:        %" PRIu64 "\n", st.heap_bytes);
+  print_u64("heap free bytes:   %" PRIu64 "\n", st.heap_free);
+  print_u64("mmap bytes:        %" PRIu64 "\n", st.mmap_bytes);
+  print_u64("mmap blocks:       %" PRIu64 "\n", st.mmap_blocks);
+  print_u64("in use bytes:      %" PRIu64 "\n", st.in_use);
+  print_u64("peak bytes:        %" PRIu64 "\n", st.peak_bytes);
+  my_free(large);
+
+  // Everything still queued goes out now.
+  if (fmtbuf_flush(out) < 0) {
+    handle_error("write");
+  }
+
+  return 0;
+}